@@ -0,0 +1,262 @@
+/*
+    aiss4: suffix array via induced sorting
+
+    Copyright (c) 2020, Sebastian Wouters
+    All rights reserved.
+
+    This file is part of aiss4, licensed under the BSD 3-Clause License.
+    A copy of the License can be found in the file LICENSE in the root
+    folder of this project.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <mutex>
+#include <new>
+
+namespace aiss4
+{
+
+
+#ifndef AISS4_HUGE_PAGES
+#define AISS4_HUGE_PAGES 0
+#endif
+
+const int huge_pages_default = AISS4_HUGE_PAGES; // without attached allocator: 0 heap, 1 transparent huge pages, 2 MAP_HUGETLB
+
+const size_t huge_page_size      = static_cast<size_t>(1) << 21; // 2 MB on x86-64
+const size_t huge_page_threshold = huge_page_size;               // smaller requests come from the heap
+
+
+/*
+    Anonymous mapping of bytes (rounded up to huge pages), aligned to a huge page:
+        mode 1: madvise(MADV_HUGEPAGE), i.e. transparent huge pages if the kernel allows them
+        mode 2: MAP_HUGETLB from the reserved pool (vm.nr_hugepages), else as mode 1
+    Returns NULL on failure. Release with unmap_pages(ptr, bytes).
+*/
+void * map_pages(const size_t bytes, const int mode)
+{
+    const size_t length = (bytes + huge_page_size - 1) & ~(huge_page_size - 1);
+    if (length == 0)
+        return NULL;
+#ifdef MAP_HUGETLB
+    if (mode == 2)
+    {
+        void * ptr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED)
+            return ptr;
+    }
+#endif
+    // One huge page extra, to cut a huge page aligned range out of the mapping
+    void * raw = mmap(NULL, length + huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED)
+        return NULL;
+    const uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+    const uintptr_t align = (start + huge_page_size - 1) & ~(static_cast<uintptr_t>(huge_page_size) - 1);
+    if (align > start)
+        munmap(raw, align - start);
+    if (align + length < start + length + huge_page_size)
+        munmap(reinterpret_cast<void *>(align + length), start + huge_page_size - align);
+#ifdef MADV_HUGEPAGE
+    if (mode > 0)
+        madvise(reinterpret_cast<void *>(align), length, MADV_HUGEPAGE);
+#endif
+    return reinterpret_cast<void *>(align);
+}
+
+
+void unmap_pages(void * ptr, const size_t bytes)
+{
+    const size_t length = (bytes + huge_page_size - 1) & ~(huge_page_size - 1);
+    if (ptr != NULL && length > 0)
+        munmap(ptr, length);
+}
+
+
+/*
+    Opt a caller-provided buffer (e.g. the suffix array) into transparent huge pages: the huge pages
+    inside [ptr, ptr + bytes) are advised before they are touched. Returns false if nothing was advised.
+*/
+bool advise_huge_pages(void * ptr, const size_t bytes)
+{
+#ifdef MADV_HUGEPAGE
+    const uintptr_t start = (reinterpret_cast<uintptr_t>(ptr) + huge_page_size - 1) & ~(static_cast<uintptr_t>(huge_page_size) - 1);
+    const uintptr_t stop  = (reinterpret_cast<uintptr_t>(ptr) + bytes) & ~(static_cast<uintptr_t>(huge_page_size) - 1);
+    if (ptr == NULL || stop <= start)
+        return false;
+    return madvise(reinterpret_cast<void *>(start), stop - start, MADV_HUGEPAGE) == 0;
+#else
+    return false;
+#endif
+}
+
+
+/*
+    Source of the work arrays of sais_implementation (bucket arrays, type bitmap, induction
+    buffers), sais_workspace and decode (LF map), attached per thread with sais_allocator_attach.
+    parallel_tasks (sais_batch, compress, decompress) attaches the allocator of the caller in its
+    threads, so allocate and deallocate can be called concurrently. Allocations are released
+    with the same allocator and byte count, mostly in LIFO order.
+*/
+class sais_allocator
+{
+    public:
+
+        virtual ~sais_allocator() {}
+
+        virtual void * allocate(const size_t bytes) = 0;
+
+        virtual void deallocate(void * ptr, const size_t bytes) = 0;
+
+};
+
+
+/*
+    Requests of at least huge_page_threshold bytes are mapped with map_pages(bytes, mode); mode 0
+    gives plain page-aligned mappings. Smaller requests come from the heap.
+*/
+class page_allocator : public sais_allocator
+{
+    public:
+
+        page_allocator(const int mode) : mode(mode) {}
+
+        void * allocate(const size_t bytes)
+        {
+            void * ptr = bytes >= huge_page_threshold ? map_pages(bytes, mode) : malloc(bytes > 0 ? bytes : 1);
+            if (ptr == NULL)
+                throw std::bad_alloc();
+            return ptr;
+        }
+
+        void deallocate(void * ptr, const size_t bytes)
+        {
+            if (bytes >= huge_page_threshold)
+                unmap_pages(ptr, bytes);
+            else
+                free(ptr);
+        }
+
+    private:
+
+        const int mode;
+
+};
+
+
+/*
+    One mapping of capacity bytes (map_pages with mode), reused across calls: requests are cut from
+    the top of the arena (64-byte aligned), and released from the top; the arena is empty again
+    when all its requests are released. Requests which do not fit come from a page_allocator.
+    Avoids the mmap, page faults and TLB set-up of each call, e.g. for repeated decode calls.
+    A lock serialises the requests of concurrent threads.
+*/
+class arena_allocator : public sais_allocator
+{
+    public:
+
+        arena_allocator(const size_t capacity, const int mode) : capacity(capacity), top(0), live(0), peak(0), fallback(mode)
+        {
+            memory = static_cast<uint8_t *>(map_pages(capacity, mode));
+            if (memory == NULL)
+                this->capacity = 0;
+        }
+
+        arena_allocator(const arena_allocator &) = delete;
+
+        arena_allocator & operator=(const arena_allocator &) = delete;
+
+        ~arena_allocator()
+        {
+            unmap_pages(memory, capacity);
+        }
+
+        void * allocate(const size_t bytes)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            const size_t length = (bytes + 63) & ~static_cast<size_t>(63);
+            if (length > capacity - top)
+                return fallback.allocate(bytes);
+            void * ptr = memory + top;
+            top += length;
+            ++live;
+            peak = top > peak ? top : peak;
+            return ptr;
+        }
+
+        void deallocate(void * ptr, const size_t bytes)
+        {
+            uint8_t * pos = static_cast<uint8_t *>(ptr);
+            if (pos < memory || pos >= memory + capacity)
+            {
+                fallback.deallocate(ptr, bytes);
+                return;
+            }
+            std::lock_guard<std::mutex> guard(lock);
+            const size_t length = (bytes + 63) & ~static_cast<size_t>(63);
+            if (pos + length == memory + top)
+                top = static_cast<size_t>(pos - memory);
+            if (--live == 0)
+                top = 0;
+        }
+
+        // Largest number of bytes in use at once
+        size_t high_water() const { return peak; }
+
+    private:
+
+        uint8_t *      memory;
+        size_t         capacity;
+        size_t         top;
+        size_t         live;
+        size_t         peak;
+        page_allocator fallback;
+        std::mutex     lock;
+
+};
+
+
+thread_local sais_allocator * sais_allocator_current = NULL;
+
+
+// Work arrays of this thread from alloc (NULL: the heap, or map_pages if AISS4_HUGE_PAGES > 0); returns the previous allocator
+sais_allocator * sais_allocator_attach(sais_allocator * alloc)
+{
+    sais_allocator * previous = sais_allocator_current;
+    sais_allocator_current = alloc;
+    return previous;
+}
+
+
+// count elements of the trivial type data_t, uninitialised; release with sais_delete(ptr, count)
+template <class data_t>
+data_t * sais_new(const size_t count)
+{
+    const size_t bytes = sizeof(data_t) * count;
+    if (sais_allocator_current != NULL)
+        return static_cast<data_t *>(sais_allocator_current->allocate(bytes));
+    void * ptr = huge_pages_default > 0 && bytes >= huge_page_threshold ? map_pages(bytes, huge_pages_default) : malloc(bytes > 0 ? bytes : 1);
+    if (ptr == NULL)
+        throw std::bad_alloc();
+    return static_cast<data_t *>(ptr);
+}
+
+
+template <class data_t>
+void sais_delete(data_t * ptr, const size_t count)
+{
+    const size_t bytes = sizeof(data_t) * count;
+    if (sais_allocator_current != NULL)
+        sais_allocator_current->deallocate(ptr, bytes);
+    else if (huge_pages_default > 0 && bytes >= huge_page_threshold)
+        unmap_pages(ptr, bytes);
+    else
+        free(ptr);
+}
+
+
+} // End of namespace aiss4
+
@@ -11,6 +11,10 @@
 
 #pragma once
 
+#include "allocator.hpp"
+#include "parallel.hpp"
+#include "rank.hpp"
+
 #include <stdint.h>
 #include <stdlib.h>
 
@@ -19,28 +23,29 @@ namespace aiss4
 {
 
 
-void decode(const int32_t pointer, const uint8_t * encoded, uint8_t * decoded, const int32_t size)
+template <class index_t>
+void decode_implementation(const index_t pointer, const uint8_t * encoded, uint8_t * decoded, const index_t size)
 {
     if (pointer < 0 || size < 1 || encoded == NULL || decoded == NULL)
         return;
 
-    int32_t * map  = new int32_t[size];
-    int32_t * head = new int32_t[256];
+    index_t * map  = sais_new<index_t>(static_cast<size_t>(size));
+    index_t   head[256];
     for (int32_t sym = 0; sym < 256; ++sym)
         head[sym] = 0;
 
-    for (int32_t idx = 0; idx < size; ++idx)
+    for (index_t idx = 0; idx < size; ++idx)
         map[idx] = head[encoded[idx]]++;
-    int32_t total = 1; // Sentinel '$'
+    index_t total = 1; // Sentinel '$'
     for (int32_t sym = 0; sym < 256; ++sym)
     {
-        int32_t tmp = head[sym];
+        index_t tmp = head[sym];
         head[sym] = total;
         total += tmp;
     }
 
-    int32_t idx = 0; // map[pointer] + head[$] = 0
-    for (int32_t cnt = 0; cnt < size; ++cnt)
+    index_t idx = 0; // map[pointer] + head[$] = 0
+    for (index_t cnt = 0; cnt < size; ++cnt)
     {
         idx = idx < pointer ? idx : idx - 1; // Sentinel '$' not represented in encoded
         uint8_t sym = encoded[idx];
@@ -48,20 +53,76 @@ void decode(const int32_t pointer, const uint8_t * encoded, uint8_t * decoded, c
         idx = map[idx] + head[sym];
     }
 
-    delete [] map;
-    delete [] head;
+    sais_delete(map, static_cast<size_t>(size));
 }
 
 
-int32_t encode(const uint8_t * orig, const int32_t * suffix, uint8_t * encoded, const int32_t size)
+void decode(const int64_t pointer, const uint8_t * encoded, uint8_t * decoded, const int64_t size)
+{
+    decode_implementation<int64_t>(pointer, encoded, decoded, size);
+}
+
+
+void decode(const int32_t pointer, const uint8_t * encoded, uint8_t * decoded, const int32_t size)
+{
+    decode_implementation<int32_t>(pointer, encoded, decoded, size);
+}
+
+
+/*
+    Decode without the map of decode: the LF mapping is computed with byte_rank_compact over encoded,
+    with checkpoints every 2^step_bits symbols. Memory next to encoded and decoded: about
+    512 * size / 2^step_bits + size / 32 bytes instead of sizeof(index_t) * size (size / 2 for
+    step_bits = 10), at the cost of counting up to 2^(step_bits - 1) bytes per LF step.
+*/
+template <class index_t>
+void decode_lean_implementation(const index_t pointer, const uint8_t * encoded, uint8_t * decoded, const index_t size, const int step_bits)
+{
+    if (pointer < 0 || size < 1 || encoded == NULL || decoded == NULL)
+        return;
+
+    const byte_rank_compact rank(encoded, static_cast<size_t>(size), step_bits);
+    index_t head[256];
+    index_t total = 1; // Sentinel '$'
+    for (int sym = 0; sym < 256; ++sym)
+    {
+        head[sym] = total;
+        total += static_cast<index_t>(rank.count(static_cast<uint8_t>(sym)));
+    }
+
+    index_t idx = 0;
+    for (index_t cnt = 0; cnt < size; ++cnt)
+    {
+        idx = idx < pointer ? idx : idx - 1; // Sentinel '$' not represented in encoded
+        const uint8_t sym = encoded[idx];
+        decoded[size - 1 - cnt] = sym;
+        idx = head[sym] + static_cast<index_t>(rank.rank(sym, static_cast<size_t>(idx)));
+    }
+}
+
+
+void decode_lean(const int64_t pointer, const uint8_t * encoded, uint8_t * decoded, const int64_t size, const int step_bits)
+{
+    decode_lean_implementation<int64_t>(pointer, encoded, decoded, size, step_bits);
+}
+
+
+void decode_lean(const int32_t pointer, const uint8_t * encoded, uint8_t * decoded, const int32_t size, const int step_bits)
+{
+    decode_lean_implementation<int32_t>(pointer, encoded, decoded, size, step_bits);
+}
+
+
+template <class index_t>
+index_t encode_implementation(const uint8_t * orig, const index_t * suffix, uint8_t * encoded, const index_t size)
 {
     if (size < 1 || orig == NULL || suffix == NULL || encoded == NULL)
         return -1;
 
     encoded[0] = orig[size - 1];
-    int32_t target  =  1;
-    int32_t pointer = -1;
-    for (int32_t idx = 0; idx < size; ++idx)
+    index_t target  =  1;
+    index_t pointer = -1;
+    for (index_t idx = 0; idx < size; ++idx)
     {
         if (suffix[idx] == 0)
             pointer = idx + 1;
@@ -72,5 +133,143 @@ int32_t encode(const uint8_t * orig, const int32_t * suffix, uint8_t * encoded,
 }
 
 
+int64_t encode(const uint8_t * orig, const int64_t * suffix, uint8_t * encoded, const int64_t size)
+{
+    return encode_implementation<int64_t>(orig, suffix, encoded, size);
+}
+
+
+int32_t encode(const uint8_t * orig, const int32_t * suffix, uint8_t * encoded, const int32_t size)
+{
+    return encode_implementation<int32_t>(orig, suffix, encoded, size);
+}
+
+
+/*
+    Encode with num_samples restart points for decode_parallel. With step = ceil(size / num_samples),
+    sample s is the text offset off = min(s * step, size) in samples[2 * s + 1] and its row in
+    samples[2 * s], counting rows as for the returned pointer (row 0 is the sentinel suffix, i.e.
+    offset size, and offset 0 has row pointer). samples holds 2 * num_samples indices.
+*/
+template <class index_t>
+index_t encode_implementation(const uint8_t * orig, const index_t * suffix, uint8_t * encoded, const index_t size, index_t * samples, const index_t num_samples)
+{
+    const index_t pointer = encode_implementation<index_t>(orig, suffix, encoded, size);
+    if (pointer < 0 || samples == NULL || num_samples < 1)
+        return pointer;
+
+    const index_t step      = size / num_samples + (size % num_samples == 0 ? 0 : 1);
+    const index_t num_inner = size / step + (size % step == 0 ? 0 : 1); // Samples with offset < size
+    for (index_t smp = 0; smp < num_samples; ++smp)
+    {
+        samples[2 * smp]     = 0;
+        samples[2 * smp + 1] = smp < num_inner ? static_cast<index_t>(smp * step) : size;
+    }
+    samples[0] = pointer;
+    for (index_t idx = 0; idx < size; ++idx)
+    {
+        const index_t odx = suffix[idx];
+        if (odx % step == 0 && odx > 0)
+            samples[2 * (odx / step)] = idx + 1;
+    }
+    return pointer;
+}
+
+
+int64_t encode(const uint8_t * orig, const int64_t * suffix, uint8_t * encoded, const int64_t size, int64_t * samples, const int64_t num_samples)
+{
+    return encode_implementation<int64_t>(orig, suffix, encoded, size, samples, num_samples);
+}
+
+
+int32_t encode(const uint8_t * orig, const int32_t * suffix, uint8_t * encoded, const int32_t size, int32_t * samples, const int32_t num_samples)
+{
+    return encode_implementation<int32_t>(orig, suffix, encoded, size, samples, num_samples);
+}
+
+
+/*
+    Decode with the restart points of encode(orig, suffix, encoded, size, samples, num_samples):
+    sample s + 1 (or the sentinel row for the last sample) starts an independent LF walk which
+    writes decoded[samples[2 * s + 1]:samples[2 * s + 3]] back to front. The LF mapping itself is
+    built with per-block symbol counts, so that all steps scale with num_threads.
+*/
+template <class index_t>
+void decode_parallel_implementation(const index_t pointer, const uint8_t * encoded, uint8_t * decoded, const index_t size, const index_t * samples, const index_t num_samples, const int num_threads)
+{
+    if (pointer < 0 || size < 1 || encoded == NULL || decoded == NULL)
+        return;
+
+    const index_t single[2] = { pointer, 0 };
+    const index_t * restart = samples == NULL || num_samples < 1 ? single : samples;
+    const int64_t num_walks = samples == NULL || num_samples < 1 ? 1 : static_cast<int64_t>(num_samples);
+
+    const int num_blocks = num_threads < 1 ? 1 : num_threads;
+    index_t * lf     = sais_new<index_t>(static_cast<size_t>(size));
+    index_t * counts = sais_new<index_t>(256 * static_cast<size_t>(num_blocks));
+    for (int64_t cnt = 0; cnt < 256 * static_cast<int64_t>(num_blocks); ++cnt)
+        counts[cnt] = 0;
+
+    // Step 1: Symbol counts per block
+    parallel_tasks(num_threads, num_blocks, [=](const int64_t blk, const int)
+    {
+        index_t * count = counts + 256 * blk;
+        const index_t stop = static_cast<index_t>((size * (blk + 1)) / num_blocks);
+        for (index_t idx = static_cast<index_t>((size * blk) / num_blocks); idx < stop; ++idx)
+            ++count[encoded[idx]];
+    });
+
+    // Step 2: First row of each symbol in each block, after the sentinel '$'
+    index_t total = 1;
+    for (int sym = 0; sym < 256; ++sym)
+    {
+        for (int blk = 0; blk < num_blocks; ++blk)
+        {
+            const index_t tmp = counts[256 * blk + sym];
+            counts[256 * blk + sym] = total;
+            total += tmp;
+        }
+    }
+
+    // Step 3: LF mapping per block
+    parallel_tasks(num_threads, num_blocks, [=](const int64_t blk, const int)
+    {
+        index_t * next = counts + 256 * blk;
+        const index_t stop = static_cast<index_t>((size * (blk + 1)) / num_blocks);
+        for (index_t idx = static_cast<index_t>((size * blk) / num_blocks); idx < stop; ++idx)
+            lf[idx] = next[encoded[idx]]++;
+    });
+
+    // Step 4: Independent LF walks from the restart points
+    parallel_tasks(num_threads, num_walks, [=](const int64_t smp, const int)
+    {
+        const index_t lo  = restart[2 * smp + 1];
+        const index_t hi  = smp + 1 < num_walks ? restart[2 * smp + 3] : size;
+        index_t       idx = smp + 1 < num_walks ? restart[2 * smp + 2] : 0;
+        for (index_t odx = hi; odx > lo; --odx)
+        {
+            idx = idx < pointer ? idx : idx - 1; // Sentinel '$' not represented in encoded
+            decoded[odx - 1] = encoded[idx];
+            idx = lf[idx];
+        }
+    });
+
+    sais_delete(counts, 256 * static_cast<size_t>(num_blocks));
+    sais_delete(lf, static_cast<size_t>(size));
+}
+
+
+void decode_parallel(const int64_t pointer, const uint8_t * encoded, uint8_t * decoded, const int64_t size, const int64_t * samples, const int64_t num_samples, const int num_threads)
+{
+    decode_parallel_implementation<int64_t>(pointer, encoded, decoded, size, samples, num_samples, num_threads);
+}
+
+
+void decode_parallel(const int32_t pointer, const uint8_t * encoded, uint8_t * decoded, const int32_t size, const int32_t * samples, const int32_t num_samples, const int num_threads)
+{
+    decode_parallel_implementation<int32_t>(pointer, encoded, decoded, size, samples, num_samples, num_threads);
+}
+
+
 } // End of namespace aiss4
 
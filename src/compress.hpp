@@ -0,0 +1,518 @@
+/*
+    aiss4: suffix array via induced sorting
+
+    Copyright (c) 2020, Sebastian Wouters
+    All rights reserved.
+
+    This file is part of aiss4, licensed under the BSD 3-Clause License.
+    A copy of the License can be found in the file LICENSE in the root
+    folder of this project.
+*/
+
+#pragma once
+
+#include "bwt.hpp"
+#include "parallel.hpp"
+#include "sais.hpp"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+namespace aiss4
+{
+
+
+/*
+    Block-wise BWT compression in the spirit of bzip2: every block of the input is sorted with
+    sais_bwt, followed by move-to-front, run-length coding of the zeros (RUNA/RUNB as in bzip2)
+    and a canonical Huffman code with one table per block.
+
+    Container (native byte order):
+        "AIS4"                                 magic
+        int64_t size                           number of input bytes
+        int32_t block_size                     input bytes per block (the last block may be shorter)
+        int64_t num_blocks                     ceil(size / block_size)
+        int64_t offsets[num_blocks + 1]        start of each block in the container, and the end
+        blocks                                 int32_t pointer, uint8_t lengths[258], Huffman bits
+
+    The block index allows to decompress blocks independently, in parallel or one at a time.
+*/
+const int compress_symbols  = 258; // RUNA, RUNB, MTF values 1 to 255, end of block
+const int compress_max_bits = 20;  // Longest Huffman code
+const int compress_fast_bits = 11; // Huffman codes decoded with one table lookup
+
+
+// MSB-first bit writer into a growing byte vector
+class bit_writer
+{
+    public:
+
+        bit_writer(std::vector<uint8_t> & out) : out(out), buffer(0), num_bits(0) {}
+
+        void put(const uint32_t code, const int len)
+        {
+            buffer = (buffer << len) | code;
+            num_bits += len;
+            while (num_bits >= 8)
+            {
+                num_bits -= 8;
+                out.push_back(static_cast<uint8_t>(buffer >> num_bits));
+            }
+        }
+
+        void flush()
+        {
+            if (num_bits > 0)
+                out.push_back(static_cast<uint8_t>(buffer << (8 - num_bits)));
+            num_bits = 0;
+        }
+
+    private:
+
+        std::vector<uint8_t> & out;
+        uint64_t buffer;
+        int      num_bits;
+
+};
+
+
+// MSB-first bit reader; reads zeros past the end, which is detected with overrun()
+class bit_reader
+{
+    public:
+
+        bit_reader(const uint8_t * data, const size_t size) : data(data), size(size), next(0), buffer(0), num_bits(0), consumed(0) {}
+
+        uint32_t peek(const int len)
+        {
+            while (num_bits <= 56)
+            {
+                buffer |= static_cast<uint64_t>(next < size ? data[next] : 0) << (56 - num_bits);
+                ++next;
+                num_bits += 8;
+            }
+            return static_cast<uint32_t>(buffer >> (64 - len));
+        }
+
+        void skip(const int len)
+        {
+            buffer <<= len;
+            num_bits -= len;
+            consumed += len;
+        }
+
+        bool overrun() const { return consumed > 8 * size; }
+
+    private:
+
+        const uint8_t * data;
+        const size_t    size;
+        size_t   next;
+        uint64_t buffer;
+        int      num_bits;
+        size_t   consumed;
+
+};
+
+
+/*
+    Code lengths of at most compress_max_bits for the symbols with freq > 0. When the Huffman tree
+    is too deep, the frequencies are halved (keeping them non-zero) and the tree is rebuilt, as in bzip2.
+*/
+void huffman_lengths(const int64_t * freq, uint8_t * lengths)
+{
+    int64_t weight[compress_symbols];
+    for (int sym = 0; sym < compress_symbols; ++sym){ weight[sym] = freq[sym]; }
+
+    while (true)
+    {
+        int symbols[compress_symbols];
+        int num_used = 0;
+        for (int sym = 0; sym < compress_symbols; ++sym)
+        {
+            lengths[sym] = 0;
+            if (weight[sym] > 0)
+                symbols[num_used++] = sym;
+        }
+        if (num_used == 0)
+            return;
+        if (num_used == 1)
+        {
+            lengths[symbols[0]] = 1;
+            return;
+        }
+        std::sort(symbols, symbols + num_used, [&weight](const int left, const int right){ return weight[left] < weight[right]; });
+
+        // Two-queue construction: leaves sorted by weight, internal nodes are created in sorted order
+        int64_t node_weight[2 * compress_symbols];
+        int     parent[2 * compress_symbols];
+        for (int leaf = 0; leaf < num_used; ++leaf){ node_weight[leaf] = weight[symbols[leaf]]; }
+        int next_leaf = 0;
+        int next_node = num_used;
+        int num_nodes = num_used;
+        auto smallest = [&]()
+        {
+            if (next_leaf < num_used && (next_node == num_nodes || node_weight[next_leaf] <= node_weight[next_node]))
+                return next_leaf++;
+            return next_node++;
+        };
+        while (num_nodes < 2 * num_used - 1)
+        {
+            const int first  = smallest();
+            const int second = smallest();
+            node_weight[num_nodes] = node_weight[first] + node_weight[second];
+            parent[first] = parent[second] = num_nodes;
+            ++num_nodes;
+        }
+
+        // Depths from the root down; parents always have larger indices than their children
+        int depth[2 * compress_symbols];
+        depth[num_nodes - 1] = 0;
+        int max_depth = 0;
+        for (int node = num_nodes - 2; node >= 0; --node)
+        {
+            depth[node] = depth[parent[node]] + 1;
+            if (node < num_used && depth[node] > max_depth){ max_depth = depth[node]; }
+        }
+        if (max_depth <= compress_max_bits)
+        {
+            for (int leaf = 0; leaf < num_used; ++leaf){ lengths[symbols[leaf]] = static_cast<uint8_t>(depth[leaf]); }
+            return;
+        }
+        for (int sym = 0; sym < compress_symbols; ++sym)
+        {
+            if (weight[sym] > 0)
+                weight[sym] = weight[sym] / 2 + 1;
+        }
+    }
+}
+
+
+// Canonical codes from the code lengths: shorter codes first, then by symbol
+void huffman_codes(const uint8_t * lengths, uint32_t * codes)
+{
+    uint32_t code = 0;
+    for (int len = 1; len <= compress_max_bits; ++len)
+    {
+        for (int sym = 0; sym < compress_symbols; ++sym)
+        {
+            if (lengths[sym] == len)
+                codes[sym] = code++;
+        }
+        code <<= 1;
+    }
+}
+
+
+/*
+    Compress one block: BWT with sais_bwt (suffix is a workspace of size entries), then move-to-front,
+    zero runs and Huffman coding, appended to out.
+*/
+void compress_block(const uint8_t * orig, const int32_t size, int32_t * suffix, uint8_t * encoded, uint16_t * mtf, std::vector<uint8_t> & out)
+{
+    const int32_t pointer = sais_bwt(orig, encoded, suffix, size);
+
+    // Step 1: Move-to-front, with runs of zeros as bijective base-2 numbers (RUNA = 1, RUNB = 2)
+    uint8_t order[256];
+    for (int sym = 0; sym < 256; ++sym){ order[sym] = static_cast<uint8_t>(sym); }
+    int64_t freq[compress_symbols];
+    for (int sym = 0; sym < compress_symbols; ++sym){ freq[sym] = 0; }
+    int32_t num_mtf = 0;
+    int32_t run = 0;
+    auto flush_run = [&]()
+    {
+        while (run > 0)
+        {
+            const uint16_t digit = (run & 1) ? 0 : 1;
+            mtf[num_mtf++] = digit;
+            ++freq[digit];
+            run = (run - 1 - digit) / 2;
+        }
+    };
+    for (int32_t idx = 0; idx < size; ++idx)
+    {
+        const uint8_t chr = encoded[idx];
+        if (order[0] == chr)
+        {
+            ++run;
+            continue;
+        }
+        flush_run();
+        int pos = 1;
+        uint8_t prev = order[0];
+        while (order[pos] != chr)
+        {
+            const uint8_t tmp = order[pos];
+            order[pos++] = prev;
+            prev = tmp;
+        }
+        order[pos] = prev;
+        order[0]   = chr;
+        mtf[num_mtf++] = static_cast<uint16_t>(pos + 1);
+        ++freq[pos + 1];
+    }
+    flush_run();
+    mtf[num_mtf++] = compress_symbols - 1; // End of block
+    ++freq[compress_symbols - 1];
+
+    // Step 2: Huffman code
+    uint8_t  lengths[compress_symbols];
+    uint32_t codes[compress_symbols];
+    huffman_lengths(freq, lengths);
+    huffman_codes(lengths, codes);
+
+    const size_t start = out.size();
+    out.resize(start + sizeof(int32_t) + compress_symbols);
+    memcpy(out.data() + start, &pointer, sizeof(int32_t));
+    memcpy(out.data() + start + sizeof(int32_t), lengths, compress_symbols);
+    bit_writer writer(out);
+    for (int32_t idx = 0; idx < num_mtf; ++idx)
+        writer.put(codes[mtf[idx]], lengths[mtf[idx]]);
+    writer.flush();
+}
+
+
+/*
+    Decompress one block of size bytes from packed[0:packed_size] into decoded. Returns false if the
+    block is malformed.
+*/
+bool decompress_block(const uint8_t * packed, const size_t packed_size, uint8_t * decoded, const int32_t size)
+{
+    if (packed_size < sizeof(int32_t) + compress_symbols)
+        return false;
+    int32_t pointer;
+    memcpy(&pointer, packed, sizeof(int32_t));
+    const uint8_t * lengths = packed + sizeof(int32_t);
+    if (pointer < 1 || pointer > size)
+        return false;
+
+    // Step 1: Canonical decoding tables; codes up to compress_fast_bits with one lookup
+    int32_t count[compress_max_bits + 1];
+    for (int len = 0; len <= compress_max_bits; ++len){ count[len] = 0; }
+    for (int sym = 0; sym < compress_symbols; ++sym)
+    {
+        if (lengths[sym] > compress_max_bits)
+            return false;
+        ++count[lengths[sym]];
+    }
+    uint32_t first[compress_max_bits + 2];  // First code of each length
+    int32_t  offset[compress_max_bits + 2]; // Index of that code in sorted
+    uint16_t sorted[compress_symbols];
+    uint32_t code = 0;
+    int32_t  total = 0;
+    for (int len = 1; len <= compress_max_bits; ++len)
+    {
+        first[len]  = code;
+        offset[len] = total;
+        for (int sym = 0; sym < compress_symbols; ++sym)
+        {
+            if (lengths[sym] == len)
+                sorted[total++] = static_cast<uint16_t>(sym);
+        }
+        code += count[len];
+        if (code > (static_cast<uint32_t>(1) << len))
+            return false; // Not a prefix code
+        code <<= 1;
+    }
+    std::vector<uint16_t> fast(static_cast<size_t>(1) << compress_fast_bits, 0); // (symbol << 5) | length, 0 if longer
+    for (int len = 1; len <= compress_fast_bits; ++len)
+    {
+        for (int32_t cnt = 0; cnt < count[len]; ++cnt)
+        {
+            const uint32_t lo = (first[len] + cnt) << (compress_fast_bits - len);
+            const uint32_t hi = lo + (1 << (compress_fast_bits - len));
+            for (uint32_t idx = lo; idx < hi; ++idx)
+                fast[idx] = static_cast<uint16_t>((sorted[offset[len] + cnt] << 5) | len);
+        }
+    }
+
+    // Step 2: Huffman decoding, zero runs and move-to-front into the BWT
+    uint8_t * encoded = new uint8_t[size];
+    uint8_t order[256];
+    for (int sym = 0; sym < 256; ++sym){ order[sym] = static_cast<uint8_t>(sym); }
+    bit_reader reader(packed + sizeof(int32_t) + compress_symbols, packed_size - sizeof(int32_t) - compress_symbols);
+    int32_t target = 0;
+    int64_t run    = 0;
+    int64_t weight = 1;
+    bool valid = true;
+    while (valid)
+    {
+        int sym = -1;
+        const uint16_t entry = fast[reader.peek(compress_fast_bits)];
+        if (entry != 0)
+        {
+            sym = entry >> 5;
+            reader.skip(entry & 31);
+        }
+        else
+        {
+            for (int len = compress_fast_bits + 1; len <= compress_max_bits; ++len)
+            {
+                const uint32_t bits = reader.peek(len);
+                if (bits - first[len] < static_cast<uint32_t>(count[len]))
+                {
+                    sym = sorted[offset[len] + bits - first[len]];
+                    reader.skip(len);
+                    break;
+                }
+            }
+        }
+        if (sym < 0 || reader.overrun())
+        {
+            valid = false;
+            break;
+        }
+
+        if (sym < 2)
+        {
+            run += weight << sym;
+            weight <<= 1;
+            valid = run <= size - target;
+            continue;
+        }
+        for (; run > 0; --run){ encoded[target++] = order[0]; }
+        weight = 1;
+        if (sym == compress_symbols - 1)
+            break;
+        if (target == size)
+        {
+            valid = false;
+            break;
+        }
+        const int pos = sym - 1;
+        const uint8_t chr = order[pos];
+        memmove(order + 1, order, pos);
+        order[0] = chr;
+        encoded[target++] = chr;
+    }
+    valid = valid && target == size;
+
+    // Step 3: Inverse BWT
+    if (valid)
+        decode(pointer, encoded, decoded, size);
+    delete [] encoded;
+    return valid;
+}
+
+
+/*
+    Compress orig[0:size] into packed, with blocks of block_size bytes sorted on num_threads threads.
+*/
+void compress(const uint8_t * orig, const int64_t size, std::vector<uint8_t> & packed, const int32_t block_size, const int num_threads)
+{
+    const int32_t bsize      = block_size < 1 ? 1 : block_size;
+    const int64_t num_blocks = size < 1 ? 0 : (size + bsize - 1) / bsize;
+    const int     threads    = num_threads < 1 ? 1 : num_threads;
+
+    // Step 1: Blocks on a pool of threads, each with its own workspace
+    std::vector<std::vector<uint8_t>> blocks(static_cast<size_t>(num_blocks));
+    const int32_t work_size = size < bsize ? static_cast<int32_t>(size) : bsize;
+    std::vector<int32_t *>  suffixes(threads, NULL);
+    std::vector<uint8_t *>  encodeds(threads, NULL);
+    std::vector<uint16_t *> mtfs(threads, NULL);
+    parallel_tasks(threads, num_blocks, [&](const int64_t blk, const int thr)
+    {
+        if (suffixes[thr] == NULL)
+        {
+            suffixes[thr] = new int32_t[work_size];
+            encodeds[thr] = new uint8_t[work_size];
+            mtfs[thr]     = new uint16_t[work_size + 1];
+        }
+        const int64_t start = blk * bsize;
+        const int32_t len   = static_cast<int32_t>(size - start < bsize ? size - start : bsize);
+        compress_block(orig + start, len, suffixes[thr], encodeds[thr], mtfs[thr], blocks[blk]);
+    });
+    for (int thr = 0; thr < threads; ++thr)
+    {
+        delete [] suffixes[thr];
+        delete [] encodeds[thr];
+        delete [] mtfs[thr];
+    }
+
+    // Step 2: Header, block index and blocks
+    const size_t header = 4 + sizeof(int64_t) + sizeof(int32_t) + sizeof(int64_t) + sizeof(int64_t) * (num_blocks + 1);
+    std::vector<int64_t> offsets(static_cast<size_t>(num_blocks + 1));
+    offsets[0] = static_cast<int64_t>(header);
+    for (int64_t blk = 0; blk < num_blocks; ++blk){ offsets[blk + 1] = offsets[blk] + static_cast<int64_t>(blocks[blk].size()); }
+    packed.resize(static_cast<size_t>(offsets[num_blocks]));
+    uint8_t * ptr = packed.data();
+    memcpy(ptr, "AIS4", 4);                                    ptr += 4;
+    memcpy(ptr, &size, sizeof(int64_t));                       ptr += sizeof(int64_t);
+    memcpy(ptr, &bsize, sizeof(int32_t));                      ptr += sizeof(int32_t);
+    memcpy(ptr, &num_blocks, sizeof(int64_t));                 ptr += sizeof(int64_t);
+    memcpy(ptr, offsets.data(), sizeof(int64_t) * (num_blocks + 1));
+    for (int64_t blk = 0; blk < num_blocks; ++blk)
+    {
+        if (!blocks[blk].empty())
+            memcpy(packed.data() + offsets[blk], blocks[blk].data(), blocks[blk].size());
+    }
+}
+
+
+/*
+    Header of a container of compress; returns false if packed[0:packed_size] is not one
+*/
+bool compressed_info(const uint8_t * packed, const size_t packed_size, int64_t & size, int32_t & block_size, int64_t & num_blocks)
+{
+    const size_t fixed = 4 + sizeof(int64_t) + sizeof(int32_t) + sizeof(int64_t);
+    if (packed == NULL || packed_size < fixed || memcmp(packed, "AIS4", 4) != 0)
+        return false;
+    memcpy(&size,       packed + 4, sizeof(int64_t));
+    memcpy(&block_size, packed + 4 + sizeof(int64_t), sizeof(int32_t));
+    memcpy(&num_blocks, packed + 4 + sizeof(int64_t) + sizeof(int32_t), sizeof(int64_t));
+    if (size < 0 || block_size < 1 || num_blocks != (size + block_size - 1) / block_size)
+        return false;
+    if (static_cast<uint64_t>(num_blocks + 1) > (packed_size - fixed) / sizeof(int64_t))
+        return false;
+    return true;
+}
+
+
+/*
+    Decompress block blk of the container into decoded[0:block_size] (less for the last block).
+    Returns the number of bytes written, or -1 if the container or the block is malformed.
+*/
+int32_t decompress_block(const uint8_t * packed, const size_t packed_size, const int64_t blk, uint8_t * decoded)
+{
+    int64_t size;
+    int32_t block_size;
+    int64_t num_blocks;
+    if (!compressed_info(packed, packed_size, size, block_size, num_blocks) || blk < 0 || blk >= num_blocks)
+        return -1;
+    const uint8_t * index = packed + 4 + sizeof(int64_t) + sizeof(int32_t) + sizeof(int64_t);
+    int64_t lo;
+    int64_t hi;
+    memcpy(&lo, index + sizeof(int64_t) * blk, sizeof(int64_t));
+    memcpy(&hi, index + sizeof(int64_t) * (blk + 1), sizeof(int64_t));
+    if (lo < 0 || hi < lo || static_cast<uint64_t>(hi) > packed_size)
+        return -1;
+    const int64_t start = blk * block_size;
+    const int32_t len   = static_cast<int32_t>(size - start < block_size ? size - start : block_size);
+    return decompress_block(packed + lo, static_cast<size_t>(hi - lo), decoded, len) ? len : -1;
+}
+
+
+/*
+    Decompress the whole container into decoded[0:size] with num_threads threads, one block per task
+*/
+bool decompress(const uint8_t * packed, const size_t packed_size, uint8_t * decoded, const int num_threads)
+{
+    int64_t size;
+    int32_t block_size;
+    int64_t num_blocks;
+    if (!compressed_info(packed, packed_size, size, block_size, num_blocks))
+        return false;
+    std::vector<uint8_t> valid(static_cast<size_t>(num_blocks), 0);
+    parallel_tasks(num_threads, num_blocks, [&](const int64_t blk, const int)
+    {
+        valid[blk] = decompress_block(packed, packed_size, blk, decoded + blk * block_size) >= 0;
+    });
+    return std::all_of(valid.begin(), valid.end(), [](const uint8_t val){ return val != 0; });
+}
+
+
+} // End of namespace aiss4
+
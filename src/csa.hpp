@@ -0,0 +1,334 @@
+/*
+    aiss4: suffix array via induced sorting
+
+    Copyright (c) 2020, Sebastian Wouters
+    All rights reserved.
+
+    This file is part of aiss4, licensed under the BSD 3-Clause License.
+    A copy of the License can be found in the file LICENSE in the root
+    folder of this project.
+*/
+
+#pragma once
+
+#include "rank.hpp"
+#include "sais.hpp"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+namespace aiss4
+{
+
+
+// Position of the (rank + 1)-th set bit of word, for rank < popcount(word)
+inline int select_in_word(uint64_t word, int rank)
+{
+#if defined(__BMI2__)
+    return __builtin_ctzll(_pdep_u64(static_cast<uint64_t>(1) << rank, word));
+#else
+    for (; rank > 0; --rank){ word &= word - 1; }
+    return __builtin_ctzll(word);
+#endif
+}
+
+
+/*
+    Compressed suffix array of Grossi and Vitter (STOC 2000) in the form of Sadakane (2003), from the
+    suffix array of sais.
+
+    Rows count the sentinel row 0 as in fm_index: row idx + 1 holds suffix[idx]. psi(row) is the row
+    of the text offset after the one of row, which increases within the rows of a first symbol
+    (a bucket). Each bucket of m rows stores its psi values as an Elias-Fano sequence over
+    [0, size]: the low floor(log2((size + 1) / m)) bits packed in lows, the high bits unary in upper.
+    All buckets together take about n H0 + 2 n bits, plus a select sample per 256 rows.
+
+    Every sample_rate-th text offset keeps its suffix array entry and its row, which bounds
+        sa(idx):  at most sample_rate - 1 psi steps
+        isa(odx): at most sample_rate - 1 psi steps
+        extract:  isa(start) plus one psi step per symbol
+    at n / sample_rate * (2 sizeof(index_t)) bytes for the samples and n / 7 bytes for the
+    marks of the sampled rows.
+*/
+template <class index_t>
+class csa
+{
+    public:
+
+        // From suffix = the result of sais(orig, suffix, size), which is left unchanged
+        csa(const uint8_t * orig, const index_t * suffix, const index_t size, const index_t sample_rate)
+            : size(size), rate(sample_rate < 1 ? 1 : sample_rate), num_codes(0), num_lows(0), num_upper(0), num_select(0), lows(NULL), upper(NULL), select_samples(NULL), sampled(NULL), sa_samples(NULL), isa_samples(NULL)
+        {
+            build(orig, suffix);
+        }
+
+        // With its own sais call
+        csa(const uint8_t * orig, const index_t size, const index_t sample_rate, const int num_threads)
+            : size(size), rate(sample_rate < 1 ? 1 : sample_rate), num_codes(0), num_lows(0), num_upper(0), num_select(0), lows(NULL), upper(NULL), select_samples(NULL), sampled(NULL), sa_samples(NULL), isa_samples(NULL)
+        {
+            if (size < 1 || orig == NULL)
+                return;
+            index_t * suffix = new index_t[size];
+            sais(orig, suffix, size, num_threads);
+            build(orig, suffix);
+            delete [] suffix;
+        }
+
+        csa(const csa &) = delete;
+
+        csa & operator=(const csa &) = delete;
+
+        ~csa()
+        {
+            delete [] lows;
+            delete [] upper;
+            delete [] select_samples;
+            delete sampled;
+            delete [] sa_samples;
+            delete [] isa_samples;
+        }
+
+        // suffix[idx] of sais, for 0 <= idx < size
+        index_t sa(const index_t idx) const
+        {
+            index_t row = idx + 1;
+            index_t steps = 0;
+            while (!sampled->get(static_cast<size_t>(row)))
+            {
+                row = psi(row, bucket(row));
+                ++steps;
+            }
+            return sa_samples[sampled->rank1(static_cast<size_t>(row))] - steps;
+        }
+
+        index_t operator[](const index_t idx) const { return sa(idx); }
+
+        // idx with suffix[idx] == odx, for 0 <= odx < size
+        index_t isa(const index_t odx) const
+        {
+            index_t row = isa_samples[odx / rate];
+            for (index_t step = odx % rate; step > 0; --step)
+                row = psi(row, bucket(row));
+            return row - 1;
+        }
+
+        // Write orig[start:start + length] to text
+        bool extract(const index_t start, const index_t length, uint8_t * text) const
+        {
+            if (start < 0 || length < 0 || start > size - length || num_codes == 0)
+                return false;
+            if (length == 0)
+                return true;
+            index_t row = isa(start) + 1;
+            for (index_t odx = 0; odx < length; ++odx)
+            {
+                const int cde = bucket(row);
+                text[odx] = symbol[cde];
+                if (odx + 1 < length){ row = psi(row, cde); }
+            }
+            return true;
+        }
+
+        index_t length() const { return size; }
+
+        // Memory of psi (lows, upper and select samples) and of the suffix array samples
+        size_t psi_bytes() const { return sizeof(uint64_t) * (num_lows + num_upper + num_select); }
+
+        size_t sample_bytes() const
+        {
+            return (sampled == NULL ? 0 : sampled->bytes()) + sizeof(index_t) * 2 * static_cast<size_t>(size / rate + 1);
+        }
+
+        size_t bytes() const { return sizeof(csa) + psi_bytes() + sample_bytes(); }
+
+    private:
+
+        static const int select_step = 256; // Rows per select sample
+
+        void build(const uint8_t * orig, const index_t * suffix)
+        {
+            if (size < 1 || orig == NULL || suffix == NULL)
+                return;
+
+            // Step 1: Buckets: code 0 is the sentinel row, codes 1, 2, ... the symbols in the text
+            index_t count[256];
+            for (int sym = 0; sym < 256; ++sym){ count[sym] = 0; }
+            for (index_t odx = 0; odx < size; ++odx){ ++count[orig[odx]]; }
+            head[0]   = 0;
+            symbol[0] = 0;
+            num_codes = 1;
+            int code[256];
+            for (int sym = 0; sym < 256; ++sym)
+            {
+                code[sym] = -1;
+                if (count[sym] == 0)
+                    continue;
+                code[sym]         = num_codes;
+                symbol[num_codes] = static_cast<uint8_t>(sym);
+                head[num_codes]   = head[num_codes - 1] + (num_codes == 1 ? 1 : count[symbol[num_codes - 1]]);
+                ++num_codes;
+            }
+            head[num_codes] = size + 1;
+
+            // Step 2: Elias-Fano layout per bucket
+            const uint64_t universe = static_cast<uint64_t>(size) + 1;
+            uint64_t low_bits = 0;
+            uint64_t up_bits  = 0;
+            for (int cde = 0; cde < num_codes; ++cde)
+            {
+                const uint64_t num = static_cast<uint64_t>(head[cde + 1] - head[cde]);
+                int wdt = 0;
+                while ((num << (wdt + 1)) <= universe){ ++wdt; }
+                width[cde]       = wdt;
+                low_start[cde]   = low_bits;
+                upper_start[cde] = up_bits;
+                low_bits += num * wdt;
+                up_bits  += num + (static_cast<uint64_t>(size) >> wdt) + 1;
+            }
+            num_lows  = static_cast<size_t>(low_bits / 64 + 2);
+            num_upper = static_cast<size_t>(up_bits / 64 + 2);
+            lows  = new uint64_t[num_lows];
+            upper = new uint64_t[num_upper];
+            for (size_t wdx = 0; wdx < num_lows;  ++wdx){ lows[wdx]  = 0; }
+            for (size_t wdx = 0; wdx < num_upper; ++wdx){ upper[wdx] = 0; }
+
+            /*
+                Step 3: psi in one pass over the rows. The BWT symbol of row is the one before its
+                offset; the rows with BWT symbol chr are, in order, the psi values of bucket chr.
+            */
+            index_t fill[257];
+            for (int cde = 0; cde < num_codes; ++cde){ fill[cde] = 0; }
+            for (index_t row = 0; row <= size; ++row)
+            {
+                const index_t odx = row == 0 ? size : suffix[row - 1];
+                const int cde = odx == 0 ? 0 : code[orig[odx - 1]];
+                const uint64_t val = static_cast<uint64_t>(row);
+                const uint64_t num = static_cast<uint64_t>(fill[cde]++);
+                const int wdt = width[cde];
+                if (wdt > 0)
+                {
+                    const uint64_t pos = low_start[cde] + num * wdt;
+                    const uint64_t low = val & ((static_cast<uint64_t>(1) << wdt) - 1);
+                    lows[pos >> 6] |= low << (pos & 63);
+                    if ((pos & 63) + wdt > 64){ lows[(pos >> 6) + 1] |= low >> (64 - (pos & 63)); }
+                }
+                const uint64_t bit = upper_start[cde] + (val >> wdt) + num;
+                upper[bit >> 6] |= static_cast<uint64_t>(1) << (bit & 63);
+            }
+
+            // Step 4: Position of every select_step-th set bit of upper, i.e. of its first row
+            num_select = static_cast<size_t>(size / select_step + 2);
+            select_samples = new uint64_t[num_select];
+            uint64_t ones = 0;
+            for (size_t wdx = 0; wdx < num_upper; ++wdx)
+            {
+                uint64_t word = upper[wdx];
+                while (word)
+                {
+                    if (ones % select_step == 0)
+                        select_samples[ones / select_step] = 64 * wdx + __builtin_ctzll(word);
+                    ++ones;
+                    word &= word - 1;
+                }
+            }
+
+            // Step 5: Sampled suffix array per row (row 0 always, so that sa stops at the sentinel) and sampled rows per text offset
+            const index_t num_samples = size / rate + 1;
+            sampled     = new bit_rank(static_cast<size_t>(size) + 1);
+            sa_samples  = new index_t[num_samples + 1];
+            isa_samples = new index_t[num_samples];
+            sampled->set(0);
+            for (index_t idx = 0; idx < size; ++idx)
+            {
+                if (suffix[idx] % rate == 0)
+                {
+                    sampled->set(static_cast<size_t>(idx) + 1);
+                    isa_samples[suffix[idx] / rate] = idx + 1;
+                }
+            }
+            sampled->finalize();
+            index_t smp = 0;
+            sa_samples[smp++] = size;
+            for (index_t idx = 0; idx < size; ++idx)
+            {
+                if (suffix[idx] % rate == 0)
+                    sa_samples[smp++] = suffix[idx];
+            }
+        }
+
+        // Code of the bucket of row
+        int bucket(const index_t row) const
+        {
+            int lo = 0;
+            int hi = num_codes; // head[lo] <= row < head[hi]
+            while (hi - lo > 1)
+            {
+                const int mid = (lo + hi) >> 1;
+                if (head[mid] <= row){ lo = mid; } else { hi = mid; }
+            }
+            return lo;
+        }
+
+        // Row of the text offset after the one of row, which lies in bucket cde
+        index_t psi(const index_t row, const int cde) const
+        {
+            const uint64_t num = static_cast<uint64_t>(row - head[cde]);
+
+            // High bits: the row-th set bit of upper, counted from the nearest select sample
+            const uint64_t row_u = static_cast<uint64_t>(row);
+            uint64_t pos  = select_samples[row_u / select_step];
+            uint64_t rest = row_u % select_step;
+            size_t   wdx  = static_cast<size_t>(pos >> 6);
+            uint64_t word = upper[wdx] & (~static_cast<uint64_t>(0) << (pos & 63));
+            uint64_t ones = __builtin_popcountll(word);
+            while (rest >= ones)
+            {
+                rest -= ones;
+                word  = upper[++wdx];
+                ones  = __builtin_popcountll(word);
+            }
+            pos = 64 * wdx + select_in_word(word, static_cast<int>(rest));
+            const uint64_t high = pos - upper_start[cde] - num;
+
+            const int wdt = width[cde];
+            uint64_t low = 0;
+            if (wdt > 0)
+            {
+                const uint64_t bit = low_start[cde] + num * wdt;
+                const int shift = static_cast<int>(bit & 63);
+                low = lows[bit >> 6] >> shift;
+                if (shift + wdt > 64){ low |= lows[(bit >> 6) + 1] << (64 - shift); }
+                low &= (static_cast<uint64_t>(1) << wdt) - 1;
+            }
+            return static_cast<index_t>((high << wdt) | low);
+        }
+
+        const index_t size;
+        const index_t rate;
+
+        int      num_codes;
+        uint8_t  symbol[257];
+        index_t  head[258];
+        int      width[257];
+        uint64_t low_start[257];
+        uint64_t upper_start[257];
+
+        size_t     num_lows;
+        size_t     num_upper;
+        size_t     num_select;
+        uint64_t * lows;
+        uint64_t * upper;
+        uint64_t * select_samples;
+        bit_rank * sampled;
+        index_t  * sa_samples;
+        index_t  * isa_samples;
+
+};
+
+
+} // End of namespace aiss4
+
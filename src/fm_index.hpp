@@ -0,0 +1,282 @@
+/*
+    aiss4: suffix array via induced sorting
+
+    Copyright (c) 2020, Sebastian Wouters
+    All rights reserved.
+
+    This file is part of aiss4, licensed under the BSD 3-Clause License.
+    A copy of the License can be found in the file LICENSE in the root
+    folder of this project.
+*/
+
+#pragma once
+
+#include "bwt.hpp"
+#include "rank.hpp"
+#include "sais.hpp"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+namespace aiss4
+{
+
+
+/*
+    FM-index of Ferragina and Manzini (FOCS 2000) over the BWT of encode, built with one sais call.
+
+    The BWT is stored as a wavelet matrix (Claude, Navarro and Ordonez, 2015) over the symbols which
+    occur in the text, with ceil(log2(sigma)) levels of bit_rank, so that rank and LF cost one cache
+    line per level. Rows count the sentinel row 0 as for the pointer of encode. Every sample_rate-th
+    text offset keeps its suffix array entry (for locate) and its row (for extract).
+*/
+template <class index_t>
+class fm_index
+{
+    public:
+
+        fm_index(const uint8_t * orig, const index_t size, const index_t sample_rate, const int num_threads)
+            : size(size), rate(sample_rate < 1 ? 1 : sample_rate), pointer(-1), num_levels(0), sampled(NULL), sa_samples(NULL), isa_samples(NULL)
+        {
+            for (int sym = 0; sym < 256; ++sym){ code[sym] = -1; }
+            if (size < 1 || orig == NULL)
+                return;
+
+            // Step 1: Suffix array and BWT
+            index_t * suffix  = new index_t[size];
+            uint8_t * encoded = new uint8_t[size];
+            sais(orig, suffix, size, num_threads);
+            pointer = encode(orig, suffix, encoded, size);
+
+            // Step 2: Dense codes for the symbols in the text, and first row per code
+            index_t count[256];
+            for (int sym = 0; sym < 256; ++sym){ count[sym] = 0; }
+            for (index_t idx = 0; idx < size; ++idx){ ++count[encoded[idx]]; }
+            int num_codes = 0;
+            index_t total = 1; // Sentinel '$'
+            for (int sym = 0; sym < 256; ++sym)
+            {
+                if (count[sym] == 0)
+                    continue;
+                code[sym]         = num_codes;
+                symbol[num_codes] = static_cast<uint8_t>(sym);
+                head[num_codes]   = total;
+                total += count[sym];
+                ++num_codes;
+            }
+            while ((1 << num_levels) < num_codes){ ++num_levels; }
+            if (num_levels == 0){ num_levels = 1; }
+
+            // Step 3: Wavelet matrix, most significant bit first, stable partition per level
+            uint8_t * codes = new uint8_t[size];
+            uint8_t * other = new uint8_t[size];
+            for (index_t idx = 0; idx < size; ++idx){ codes[idx] = static_cast<uint8_t>(code[encoded[idx]]); }
+            delete [] encoded;
+            for (int lvl = 0; lvl < num_levels; ++lvl)
+            {
+                const int shift = num_levels - 1 - lvl;
+                levels[lvl].resize(static_cast<size_t>(size));
+                for (index_t idx = 0; idx < size; ++idx)
+                {
+                    if ((codes[idx] >> shift) & 1)
+                        levels[lvl].set(static_cast<size_t>(idx));
+                }
+                levels[lvl].finalize();
+                zeros[lvl] = static_cast<index_t>(levels[lvl].rank0(static_cast<size_t>(size)));
+                index_t lo = 0;
+                index_t hi = zeros[lvl];
+                for (index_t idx = 0; idx < size; ++idx)
+                {
+                    if ((codes[idx] >> shift) & 1)
+                        other[hi++] = codes[idx];
+                    else
+                        other[lo++] = codes[idx];
+                }
+                uint8_t * tmp = codes;
+                codes = other;
+                other = tmp;
+            }
+            delete [] codes;
+            delete [] other;
+
+            // Step 4: Start of each code in the last level, so that rank needs one rank per level
+            for (int cde = 0; cde < num_codes; ++cde)
+            {
+                size_t pos = 0;
+                for (int lvl = 0; lvl < num_levels; ++lvl)
+                {
+                    if ((cde >> (num_levels - 1 - lvl)) & 1)
+                        pos = static_cast<size_t>(zeros[lvl]) + levels[lvl].rank1(pos);
+                    else
+                        pos = levels[lvl].rank0(pos);
+                }
+                first[cde] = static_cast<index_t>(pos);
+            }
+
+            // Step 5: Sampled suffix array per row, and sampled rows per text offset
+            const index_t num_samples = size / rate + 1;
+            sampled     = new bit_rank(static_cast<size_t>(size) + 1);
+            sa_samples  = new index_t[num_samples];
+            isa_samples = new index_t[num_samples];
+            if (size % rate == 0){ sampled->set(0); }
+            isa_samples[size / rate] = 0;
+            for (index_t sdx = 0; sdx < size; ++sdx)
+            {
+                if (suffix[sdx] % rate == 0)
+                {
+                    sampled->set(static_cast<size_t>(sdx) + 1);
+                    isa_samples[suffix[sdx] / rate] = sdx + 1;
+                }
+            }
+            sampled->finalize();
+            index_t smp = 0;
+            if (size % rate == 0){ sa_samples[smp++] = size; }
+            for (index_t sdx = 0; sdx < size; ++sdx)
+            {
+                if (suffix[sdx] % rate == 0)
+                    sa_samples[smp++] = suffix[sdx];
+            }
+            delete [] suffix;
+        }
+
+        fm_index(const fm_index &) = delete;
+
+        fm_index & operator=(const fm_index &) = delete;
+
+        ~fm_index()
+        {
+            delete sampled;
+            delete [] sa_samples;
+            delete [] isa_samples;
+        }
+
+        // Rows [lo, hi) of the suffixes starting with pattern; returns hi - lo
+        index_t range(const uint8_t * pattern, const index_t length, index_t & lo, index_t & hi) const
+        {
+            lo = 0;
+            hi = pointer < 0 ? 0 : size + 1;
+            for (index_t idx = length; idx > 0 && lo < hi; --idx)
+            {
+                const int cde = code[pattern[idx - 1]];
+                if (cde < 0)
+                {
+                    lo = hi = 0;
+                    break;
+                }
+                lo = head[cde] + rank(cde, lo);
+                hi = head[cde] + rank(cde, hi);
+            }
+            return hi - lo;
+        }
+
+        // Number of occurrences of pattern in orig
+        index_t count(const uint8_t * pattern, const index_t length) const
+        {
+            index_t lo;
+            index_t hi;
+            return range(pattern, length, lo, hi);
+        }
+
+        // Text offset of the suffix in row, with at most sample_rate - 1 LF steps
+        index_t locate(index_t row) const
+        {
+            index_t steps = 0;
+            while (!sampled->get(static_cast<size_t>(row)))
+            {
+                row = lf(row, NULL);
+                ++steps;
+            }
+            return sa_samples[sampled->rank1(static_cast<size_t>(row))] + steps;
+        }
+
+        // Write up to max_hits text offsets of pattern (unsorted) to hits; returns the number of occurrences
+        index_t locate(const uint8_t * pattern, const index_t length, index_t * hits, const index_t max_hits) const
+        {
+            index_t lo;
+            index_t hi;
+            const index_t num_hits = range(pattern, length, lo, hi);
+            for (index_t row = lo; row < hi && row - lo < max_hits; ++row)
+                hits[row - lo] = locate(row);
+            return num_hits;
+        }
+
+        // Write orig[start:start + length] to text, with LF steps from the next sampled offset
+        bool extract(const index_t start, const index_t length, uint8_t * text) const
+        {
+            if (start < 0 || length < 0 || start > size - length || pointer < 0)
+                return false;
+            const index_t stop = start + length;
+            index_t odx = (stop / rate + (stop % rate == 0 ? 0 : 1)) * rate;
+            odx = odx < size ? odx : size;
+            index_t row = isa_samples[odx / rate];
+            if (odx == size){ row = 0; }
+            for (; odx > start; --odx)
+            {
+                uint8_t chr;
+                row = lf(row, &chr);
+                if (odx <= stop){ text[odx - 1 - start] = chr; }
+            }
+            return true;
+        }
+
+        index_t length() const { return size; }
+
+    private:
+
+        // Occurrences of code cde in the BWT rows [0, row)
+        index_t rank(const int cde, const index_t row) const
+        {
+            size_t pos = static_cast<size_t>(row > pointer ? row - 1 : row); // '$' not in the wavelet matrix
+            for (int lvl = 0; lvl < num_levels; ++lvl)
+            {
+                if ((cde >> (num_levels - 1 - lvl)) & 1)
+                    pos = static_cast<size_t>(zeros[lvl]) + levels[lvl].rank1(pos);
+                else
+                    pos = levels[lvl].rank0(pos);
+            }
+            return static_cast<index_t>(pos) - first[cde];
+        }
+
+        // Row of the text offset before the one of row (row != pointer), and the BWT symbol of row
+        index_t lf(const index_t row, uint8_t * chr) const
+        {
+            size_t pos = static_cast<size_t>(row > pointer ? row - 1 : row);
+            int cde = 0;
+            for (int lvl = 0; lvl < num_levels; ++lvl)
+            {
+                const size_t ones = levels[lvl].rank1(pos);
+                if (levels[lvl].get(pos))
+                {
+                    cde = (cde << 1) | 1;
+                    pos = static_cast<size_t>(zeros[lvl]) + ones;
+                }
+                else
+                {
+                    cde = cde << 1;
+                    pos = pos - ones;
+                }
+            }
+            if (chr != NULL){ *chr = symbol[cde]; }
+            return head[cde] + static_cast<index_t>(pos) - first[cde];
+        }
+
+        const index_t size;
+        const index_t rate;
+        index_t pointer;
+
+        int     code[256];
+        uint8_t symbol[256];
+        index_t head[256];
+        index_t first[256];
+        index_t zeros[8];
+
+        int        num_levels;
+        bit_rank   levels[8];
+        bit_rank * sampled;
+        index_t  * sa_samples;
+        index_t  * isa_samples;
+
+};
+
+
+} // End of namespace aiss4
@@ -0,0 +1,82 @@
+/*
+    aiss4: suffix array via induced sorting
+
+    Copyright (c) 2020, Sebastian Wouters
+    All rights reserved.
+
+    This file is part of aiss4, licensed under the BSD 3-Clause License.
+    A copy of the License can be found in the file LICENSE in the root
+    folder of this project.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <memory.h>
+
+namespace aiss4
+{
+
+
+/*
+    40-bit integer packed in 5 bytes (no padding, alignment 1), little-endian.
+
+    Arithmetic happens on value_t (int64_t or uint64_t) through the implicit conversions, so the
+    type can replace index_t (int40_t) or token_t (uint40_t) in sais_implementation: a suffix array
+    of a text up to 2^39 - 1 bytes (512 GB) then takes 5n instead of 8n bytes.
+*/
+template <class value_t>
+class packed40
+{
+    public:
+
+        packed40() {}
+
+        packed40(const value_t value)
+        {
+            memcpy(bytes, &value, 5);
+        }
+
+        operator value_t() const
+        {
+            uint64_t value = 0;
+            memcpy(&value, bytes, 5);
+            return static_cast<value_t>(value << 24) >> 24; // sign extension for int64_t
+        }
+
+        packed40 operator~() const { return ~static_cast<value_t>(*this); } // keeps a ? ~odx : odx in packed40
+
+        packed40 & operator+=(const value_t value) { return *this = static_cast<value_t>(*this) + value; }
+        packed40 & operator-=(const value_t value) { return *this = static_cast<value_t>(*this) - value; }
+        packed40 & operator++() { return *this += 1; }
+        packed40 & operator--() { return *this -= 1; }
+        packed40 operator++(int) { packed40 old = *this; *this += 1; return old; }
+        packed40 operator--(int) { packed40 old = *this; *this -= 1; return old; }
+
+    private:
+
+        uint8_t bytes[5];
+
+};
+
+typedef packed40<int64_t>  int40_t;
+typedef packed40<uint64_t> uint40_t;
+
+static_assert(sizeof(int40_t) == 5 && sizeof(uint40_t) == 5, "packed40 must not be padded");
+
+const int64_t int40_max = (static_cast<int64_t>(1) << 39) - 1; // largest text for an int40_t suffix array (~odx must stay negative)
+
+
+/*
+    Unsigned counterpart of an index type: recursion characters of the same width
+*/
+template <class index_t> struct unsigned_index { };
+template <> struct unsigned_index<int8_t>  { typedef uint8_t  type; };
+template <> struct unsigned_index<int16_t> { typedef uint16_t type; };
+template <> struct unsigned_index<int32_t> { typedef uint32_t type; };
+template <> struct unsigned_index<int64_t> { typedef uint64_t type; };
+template <> struct unsigned_index<int40_t> { typedef uint40_t type; };
+
+
+} // End of namespace aiss4
@@ -0,0 +1,230 @@
+/*
+    aiss4: suffix array via induced sorting
+
+    Copyright (c) 2020, Sebastian Wouters
+    All rights reserved.
+
+    This file is part of aiss4, licensed under the BSD 3-Clause License.
+    A copy of the License can be found in the file LICENSE in the root
+    folder of this project.
+*/
+
+#pragma once
+
+#include "allocator.hpp"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+#include <mutex>
+#include <vector>
+
+namespace aiss4
+{
+
+
+/*
+    num_threads - 1 persistent worker threads and the calling thread. run(func) calls func(thread)
+    for every thread in [0, num_threads), the calling thread being the last one, and returns when
+    all calls are done, so that it acts as barrier. Idle workers spin briefly (yielding the core)
+    before they sleep, which keeps the latency of many short runs low without threads being created.
+*/
+class thread_pool
+{
+    public:
+
+        thread_pool(const int num_threads) : threads(num_threads < 1 ? 1 : num_threads), call(NULL), context(NULL), generation(0), pending(0), stop(false)
+        {
+            workers.reserve(static_cast<size_t>(threads - 1));
+            for (int thr = 0; thr < threads - 1; ++thr)
+                workers.emplace_back(&thread_pool::work, this, thr);
+        }
+
+        thread_pool(const thread_pool &) = delete;
+
+        thread_pool & operator=(const thread_pool &) = delete;
+
+        ~thread_pool()
+        {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                stop = true;
+            }
+            wake.notify_all();
+            for (std::thread & worker : workers)
+                worker.join();
+        }
+
+        int size() const { return threads; }
+
+        template <class func_t>
+        void run(func_t & func)
+        {
+            if (threads == 1)
+            {
+                func(0);
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                call    = [](void * ctx, const int thr){ (*static_cast<func_t *>(ctx))(thr); };
+                context = &func;
+                pending.store(threads - 1, std::memory_order_relaxed);
+                generation.fetch_add(1, std::memory_order_release);
+            }
+            wake.notify_all();
+            func(threads - 1);
+            for (int spin = 0; spin < spin_limit && pending.load(std::memory_order_acquire) > 0; ++spin)
+                std::this_thread::yield();
+            if (pending.load(std::memory_order_acquire) > 0)
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                done.wait(guard, [this](){ return pending.load(std::memory_order_acquire) == 0; });
+            }
+        }
+
+    private:
+
+        static const int spin_limit = 256;
+
+        void work(const int thr)
+        {
+            uint64_t seen = 0;
+            while (true)
+            {
+                for (int spin = 0; spin < spin_limit && generation.load(std::memory_order_acquire) == seen; ++spin)
+                    std::this_thread::yield();
+                void (*todo)(void *, int);
+                void * ctx;
+                {
+                    std::unique_lock<std::mutex> guard(lock);
+                    wake.wait(guard, [this, seen](){ return stop || generation.load(std::memory_order_acquire) != seen; });
+                    if (stop)
+                        return;
+                    seen = generation.load(std::memory_order_acquire);
+                    todo = call;
+                    ctx  = context;
+                }
+                todo(ctx, thr);
+                if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    done.notify_one();
+                }
+            }
+        }
+
+        const int                threads;
+        std::vector<std::thread> workers;
+        std::mutex               lock;
+        std::condition_variable  wake;
+        std::condition_variable  done;
+        void                  (* call)(void *, int);
+        void                   * context;
+        std::atomic<uint64_t>    generation;
+        std::atomic<int>         pending;
+        bool                     stop;
+
+};
+
+
+/*
+    Call func(task, thread) for every task in [0, num_tasks), with thread in [0, num_threads).
+    Each thread starts on a contiguous range of tasks and takes them from the front; a thread
+    without tasks steals the back half of the largest remaining range, so that tasks of very
+    different cost still balance. The calling thread is the last thread. The sais_allocator of
+    the calling thread is attached in the other threads while they run tasks.
+*/
+template <class func_t>
+void parallel_tasks(const int num_threads, const int64_t num_tasks, func_t func)
+{
+    int threads = num_threads < 1 ? 1 : num_threads;
+    if (num_tasks < threads)
+        threads = num_tasks < 1 ? 1 : static_cast<int>(num_tasks);
+    if (threads == 1)
+    {
+        for (int64_t task = 0; task < num_tasks; ++task)
+            func(task, 0);
+        return;
+    }
+
+    struct task_range
+    {
+        std::mutex lock;
+        int64_t    lo;
+        int64_t    hi;
+    };
+    task_range * ranges = new task_range[threads];
+    for (int thr = 0; thr < threads; ++thr)
+    {
+        ranges[thr].lo = (num_tasks * thr) / threads;
+        ranges[thr].hi = (num_tasks * (thr + 1)) / threads;
+    }
+
+    sais_allocator * alloc = sais_allocator_current;
+    auto worker = [ranges, threads, alloc, &func](const int thr)
+    {
+        sais_allocator * previous = sais_allocator_attach(alloc);
+        task_range & own = ranges[thr];
+        while (true)
+        {
+            int64_t task = -1;
+            {
+                std::lock_guard<std::mutex> guard(own.lock);
+                if (own.lo < own.hi)
+                    task = own.lo++;
+            }
+            if (task >= 0)
+            {
+                func(task, thr);
+                continue;
+            }
+
+            // Steal the back half of the largest range; stop when all ranges are empty
+            int     victim = -1;
+            int64_t most   = 0;
+            for (int vic = 0; vic < threads; ++vic)
+            {
+                std::lock_guard<std::mutex> guard(ranges[vic].lock);
+                if (ranges[vic].hi - ranges[vic].lo > most)
+                {
+                    most   = ranges[vic].hi - ranges[vic].lo;
+                    victim = vic;
+                }
+            }
+            if (victim < 0)
+            {
+                sais_allocator_attach(previous);
+                return;
+            }
+            int64_t lo;
+            int64_t hi;
+            {
+                std::lock_guard<std::mutex> guard(ranges[victim].lock);
+                hi = ranges[victim].hi;
+                lo = hi - (hi - ranges[victim].lo + 1) / 2;
+                ranges[victim].hi = lo;
+            }
+            std::lock_guard<std::mutex> guard(own.lock);
+            own.lo = lo;
+            own.hi = hi;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(static_cast<size_t>(threads - 1));
+    for (int thr = 0; thr < threads - 1; ++thr)
+        workers.emplace_back(worker, thr);
+    worker(threads - 1);
+
+    for (std::thread & thread : workers)
+        thread.join();
+
+    delete [] ranges;
+}
+
+
+} // End of namespace aiss4
+
@@ -0,0 +1,265 @@
+/*
+    aiss4: suffix array via induced sorting
+
+    Copyright (c) 2020, Sebastian Wouters
+    All rights reserved.
+
+    This file is part of aiss4, licensed under the BSD 3-Clause License.
+    A copy of the License can be found in the file LICENSE in the root
+    folder of this project.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <memory.h>
+
+namespace aiss4
+{
+
+
+/*
+    Number of occurrences of chr in seq[0:len], eight bytes at a time
+*/
+size_t count_byte(const uint8_t * seq, size_t len, const uint8_t chr)
+{
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t low7 = 0x7F7F7F7F7F7F7F7FULL;
+    const uint64_t pattern = ones * chr;
+    size_t count = 0;
+    uint64_t word;
+    while (len >= 8)
+    {
+        memcpy(&word, seq, 8);
+        word ^= pattern; // zero bytes where seq == chr
+        count += __builtin_popcountll(~(((word & low7) + low7) | word) & ~low7);
+        seq += 8;
+        len -= 8;
+    }
+    while (len > 0)
+    {
+        count += *seq++ == chr;
+        --len;
+    }
+    return count;
+}
+
+
+/*
+    rank(chr, pos) = number of occurrences of chr in seq[0:pos]
+
+    The counts of all 256 symbols are sampled every 2^step_bits positions; the remainder is counted
+    with count_byte. Memory: 256 * sizeof(count_t) * size / 2^step_bits bytes, next to seq itself.
+*/
+template <class count_t>
+class byte_rank
+{
+    public:
+
+        byte_rank(const uint8_t * seq, const size_t size, const int step_bits) : seq(seq), step_bits(step_bits)
+        {
+            const size_t num_samples = (size >> step_bits) + 1;
+            samples = new count_t[256 * num_samples];
+            count_t * current = samples;
+            for (int chr = 0; chr < 256; ++chr){ current[chr] = 0; }
+            for (size_t smp = 1; smp < num_samples; ++smp)
+            {
+                count_t * next = current + 256;
+                memcpy(next, current, 256 * sizeof(count_t));
+                const uint8_t * ptr = seq + ((smp - 1) << step_bits);
+                for (size_t idx = 0; idx < (static_cast<size_t>(1) << step_bits); ++idx){ ++next[ptr[idx]]; }
+                current = next;
+            }
+        }
+
+        ~byte_rank()
+        {
+            delete [] samples;
+        }
+
+        count_t rank(const uint8_t chr, const size_t pos) const
+        {
+            const size_t smp = pos >> step_bits;
+            const size_t start = smp << step_bits;
+            return samples[256 * smp + chr] + static_cast<count_t>(count_byte(seq + start, pos - start, chr));
+        }
+
+    private:
+
+        const uint8_t * seq;
+        const int step_bits;
+        count_t * samples;
+
+};
+
+
+/*
+    rank(chr, pos) = number of occurrences of chr in seq[0:pos], with two levels of counts: 64-bit
+    counts of all 256 symbols every 2^16 positions, and 16-bit counts relative to those every
+    2^step_bits positions (6 <= step_bits <= 16). The remainder is counted with count_byte from the
+    nearest checkpoint, before or after pos. Memory: 512 * size / 2^step_bits + size / 32 bytes.
+*/
+class byte_rank_compact
+{
+    public:
+
+        byte_rank_compact(const uint8_t * seq, const size_t size, const int step_bits)
+            : seq(seq), size(size), step_bits(step_bits < 6 ? 6 : (step_bits > 16 ? 16 : step_bits))
+        {
+            const size_t num_supers = (size >> 16) + 1;
+            const size_t num_blocks = (size >> this->step_bits) + 1;
+            supers = new uint64_t[256 * num_supers];
+            blocks = new uint16_t[256 * num_blocks];
+            uint64_t running[256];
+            for (int chr = 0; chr < 256; ++chr){ running[chr] = 0; }
+            const size_t step = static_cast<size_t>(1) << this->step_bits;
+            for (size_t blk = 0; blk < num_blocks; ++blk)
+            {
+                const size_t start = blk << this->step_bits;
+                uint64_t * super = supers + 256 * (start >> 16);
+                if ((start & 0xFFFF) == 0)
+                    memcpy(super, running, 256 * sizeof(uint64_t));
+                for (int chr = 0; chr < 256; ++chr){ blocks[256 * blk + chr] = static_cast<uint16_t>(running[chr] - super[chr]); }
+                const size_t stop = start + step < size ? start + step : size;
+                for (size_t idx = start; idx < stop; ++idx){ ++running[seq[idx]]; }
+            }
+            for (int chr = 0; chr < 256; ++chr){ total[chr] = running[chr]; }
+        }
+
+        byte_rank_compact(const byte_rank_compact &) = delete;
+
+        byte_rank_compact & operator=(const byte_rank_compact &) = delete;
+
+        ~byte_rank_compact()
+        {
+            delete [] supers;
+            delete [] blocks;
+        }
+
+        size_t rank(const uint8_t chr, const size_t pos) const
+        {
+            const size_t blk   = pos >> step_bits;
+            const size_t start = blk << step_bits;
+            const size_t next  = start + (static_cast<size_t>(1) << step_bits);
+            if (pos - start > (next - pos) && next <= size)
+                return sampled(chr, blk + 1) - count_byte(seq + pos, next - pos, chr);
+            return sampled(chr, blk) + count_byte(seq + start, pos - start, chr);
+        }
+
+        // Occurrences of chr in seq[0:size]
+        size_t count(const uint8_t chr) const { return static_cast<size_t>(total[chr]); }
+
+        // Cache lines of a later rank(chr, pos)
+        void prefetch(const uint8_t chr, const size_t pos) const
+        {
+            const size_t blk = pos >> step_bits;
+            __builtin_prefetch(blocks + 256 * blk + chr);
+            __builtin_prefetch(blocks + 256 * (blk + 1) + chr);
+            __builtin_prefetch(seq + pos);
+        }
+
+    private:
+
+        size_t sampled(const uint8_t chr, const size_t blk) const
+        {
+            return static_cast<size_t>(supers[256 * ((blk << step_bits) >> 16) + chr] + blocks[256 * blk + chr]);
+        }
+
+        const uint8_t * seq;
+        const size_t    size;
+        const int       step_bits;
+        uint64_t * supers;
+        uint16_t * blocks;
+        uint64_t   total[256];
+
+};
+
+
+/*
+    Bit vector with rank, interleaved per cache line: every block of eight 64-bit words holds the
+    number of ones before the block, followed by 448 bits, so that rank1(pos) reads one cache line
+    and counts at most seven words with popcount. Memory: 8 / 7 bits per bit.
+*/
+class bit_rank
+{
+    public:
+
+        bit_rank() : size(0), memory(NULL), blocks(NULL) {}
+
+        bit_rank(const size_t size) : size(0), memory(NULL), blocks(NULL) { resize(size); }
+
+        bit_rank(const bit_rank &) = delete;
+
+        bit_rank & operator=(const bit_rank &) = delete;
+
+        ~bit_rank()
+        {
+            delete [] memory;
+        }
+
+        // size bits, all zero
+        void resize(const size_t bits)
+        {
+            delete [] memory;
+            size = bits;
+            const size_t num_words = 8 * (size / 448 + 1);
+            memory = new uint64_t[num_words + 7];
+            blocks = memory;
+            while (reinterpret_cast<uintptr_t>(blocks) & 63){ ++blocks; } // Align to a cache line
+            for (size_t wdx = 0; wdx < num_words; ++wdx){ blocks[wdx] = 0; }
+        }
+
+        void set(const size_t pos)
+        {
+            const size_t off = pos % 448;
+            blocks[8 * (pos / 448) + 1 + (off >> 6)] |= static_cast<uint64_t>(1) << (off & 63);
+        }
+
+        // Counts per block, after the last set
+        void finalize()
+        {
+            uint64_t total = 0;
+            for (size_t blk = 0; blk <= size / 448; ++blk)
+            {
+                uint64_t * block = blocks + 8 * blk;
+                block[0] = total;
+                for (int wdx = 1; wdx < 8; ++wdx){ total += __builtin_popcountll(block[wdx]); }
+            }
+        }
+
+        bool get(const size_t pos) const
+        {
+            const size_t off = pos % 448;
+            return (blocks[8 * (pos / 448) + 1 + (off >> 6)] >> (off & 63)) & 1;
+        }
+
+        // Number of ones in [0, pos), for pos <= size
+        size_t rank1(const size_t pos) const
+        {
+            const uint64_t * block = blocks + 8 * (pos / 448);
+            const size_t off = pos % 448;
+            const size_t num = off >> 6;
+            uint64_t count = block[0];
+            for (size_t wdx = 1; wdx <= num; ++wdx){ count += __builtin_popcountll(block[wdx]); }
+            if (off & 63)
+                count += __builtin_popcountll(block[num + 1] & ((static_cast<uint64_t>(1) << (off & 63)) - 1));
+            return static_cast<size_t>(count);
+        }
+
+        size_t rank0(const size_t pos) const { return pos - rank1(pos); }
+
+        // Memory of the blocks
+        size_t bytes() const { return memory == NULL ? 0 : sizeof(uint64_t) * 8 * (size / 448 + 1); }
+
+    private:
+
+        size_t     size;
+        uint64_t * memory;
+        uint64_t * blocks;
+
+};
+
+
+} // End of namespace aiss4
+
@@ -11,36 +11,91 @@
 
 #pragma once
 
+#include "allocator.hpp"
+#include "sais_induce.hpp"
+#include "int40.hpp"
+#include "sais_stats.hpp"
+#include "sais_types.hpp"
+#include "sais_compare.hpp"
+#include "sais_engine.hpp"
+
 #include <stdint.h>
 #include <stdlib.h>
 #include <memory.h>
+#include <stdexcept>
 
 namespace aiss4
 {
 
 
 template <class index_t, class data_t, class idx_t>
-void sais_recursion(index_t * suffix, const index_t str_size, const index_t num_lms, const index_t name, const index_t bound);
+void sais_recursion(index_t * suffix, const index_t str_size, const index_t num_lms, const index_t name, const index_t bound, const int num_threads, const sais_engine engine);
 
 
-template <class token_t, class index_t>
-void sais_implementation(const token_t * orig, const index_t abc_size, index_t * suffix, const index_t str_size, index_t * work1, index_t * work2)
+/*
+    Compile-time alphabet size of a text type (0: given at run time), specialised for packed texts
+*/
+template <class text_t>
+struct fixed_alphabet
 {
-    if (str_size < 2 || abc_size < 2 || orig == NULL || suffix == NULL)
+    static const int size = 0;
+};
+
+
+template <class token_t>
+inline bool null_text(const token_t * orig)
+{
+    return orig == NULL;
+}
+
+
+template <class text_t>
+inline bool null_text(const text_t &)
+{
+    return false;
+}
+
+
+/*
+    orig is a const token_t * or a packed text with operator[] returning token_t (sais_dna.hpp)
+    work1 and work2 hold abc_size entries, and work3 str_size / 64 + 1 words; NULL is allocated here
+*/
+template <class token_t, class index_t, class text_t>
+void sais_implementation(const text_t orig, const index_t abc_input, index_t * suffix, const index_t str_size, index_t * work1, index_t * work2, const int num_threads, index_t * primary, const sais_engine engine = engine_induce, uint64_t * work3 = NULL)
+{
+    if (str_size < 2 || abc_input < 2 || null_text(orig) || suffix == NULL)
     {
         if (str_size == 1)
             suffix[0] = 0;
+        if (str_size == 1 && primary)
+            *primary = 0;
         return;
     }
 
-    index_t * head = work1 ? work1 : new index_t[abc_size];
-    index_t * locs = work2 ? work2 : new index_t[abc_size];
+    // With a fixed alphabet, the bucket arrays are on the stack and the bucket loops have constant bounds
+    const int fixed_abc = fixed_alphabet<text_t>::size;
+    const index_t abc_size = fixed_abc > 0 ? static_cast<index_t>(fixed_abc) : abc_input;
+    index_t fixed_head[fixed_abc > 0 ? fixed_abc : 1];
+    index_t fixed_locs[fixed_abc > 0 ? fixed_abc : 1];
+
+    sais_stats_recorder stats(static_cast<int64_t>(str_size), static_cast<int64_t>(abc_size), work1 == NULL && fixed_abc == 0, work2 == NULL && fixed_abc == 0);
+    index_t * head = fixed_abc > 0 ? fixed_head : (work1 ? work1 : sais_new<index_t>(static_cast<size_t>(abc_size)));
+    index_t * locs = fixed_abc > 0 ? fixed_locs : (work2 ? work2 : sais_new<index_t>(static_cast<size_t>(abc_size)));
     const size_t memcpy_head_size = sizeof(index_t) * static_cast<size_t>(abc_size);
     const size_t memcpy_tail_size = sizeof(index_t) * static_cast<size_t>(abc_size - 1);
 
-    // Step 0: Compute bucket heads
-    for (index_t chr = 0; chr < abc_size; ++chr){ head[chr] = 0; }
-    for (index_t odx = 0; odx < str_size; ++odx){ ++head[orig[odx]]; }
+    // Block-wise induction sweeps if multiple threads are requested and there is enough work to share,
+    // or serial sweeps with read-ahead windows if enabled and the text exceeds the caches
+    induce_buffer<token_t, index_t> * induce = NULL;
+    if (num_threads > 1 && static_cast<size_t>(str_size) > 2 * induce_block)
+        induce = new induce_buffer<token_t, index_t>(num_threads, str_size, abc_size, induce_block);
+    else if (induce_window > 0 && static_cast<size_t>(str_size) > induce_window_min)
+        induce = new induce_buffer<token_t, index_t>(1, str_size, abc_size, induce_window);
+
+    // Step 0: Compute bucket heads, and the suffix types in a bitmap of str_size / 8 bytes for Steps 1, 5 and 8
+    const size_t stype_words = static_cast<size_t>(str_size) / 64 + 1;
+    uint64_t * stype = work3 ? work3 : sais_new<uint64_t>(stype_words);
+    classify_types(orig, str_size, stype, head, abc_size);
     {
         index_t total = 0;
         index_t tmp;
@@ -51,122 +106,138 @@ void sais_implementation(const token_t * orig, const index_t abc_size, index_t *
             total += tmp;
         }
     }
+    if (induce)
+        induce->split_buckets(orig, stype, str_size, head);
+    stats.step(0);
 
-    // Step 1:  Place the L prefix indices of LMS substrings (i.e. index of preceding L-type character) at bucket tail
-    // Bucket:  [ 0 0 0 0 (L-string) | 0 0 0 0 (S-string) ] --> [ 0 0 0 0 (L-string) | 0 0 a b (S-string) ]
-    //          orig[a], orig[b] are L-type prefixes of LMS substrings
-    memcpy(locs, head + 1, memcpy_tail_size); locs[abc_size - 1] = str_size;
+    // Number of LMS positions, and the engine for Steps 1 to 4
     index_t num_lms = 0;
+    for (int64_t wdx = static_cast<int64_t>(str_size) / 64; wdx >= 0; --wdx){ num_lms += static_cast<index_t>(__builtin_popcountll(lms_word(stype, wdx))); }
+    const sais_engine chosen = engine == engine_auto ? choose_engine(head, abc_size, str_size, num_lms) : engine;
+
+    if (chosen == engine_twostage && sort_lms_twostage(orig, stype, str_size, suffix, num_lms))
     {
-        for (index_t sdx = 0; sdx < str_size; ++sdx) { suffix[sdx] = 0; }
-        index_t odx = str_size - 1; // orig     index
-        token_t cur;                // current  character
-        token_t prv = orig[odx--];  // previous character: orig[str_size - 1] is L-type
-        while (odx > 0) // orig[0] cannot be LMS
-        {
-            while (odx >= 0 && (cur = orig[odx]) >= prv){ --odx; prv = cur; } // First S-type is cur = orig[odx]; prv L-type
-            while (odx >= 0 && (cur = orig[odx]) <= prv){ --odx; prv = cur; } // First L-type is cur = orig[odx]; prv S-type
-            if (odx >= 0)
-            {
-                suffix[--locs[prv]] = odx; // Index of preceding L-type character
-                ++num_lms;
-            }
-        }
+        stats.step(1);
+        stats.step(2);
+        stats.step(3);
+        stats.step(4);
     }
-
-    // Step 2:  Place the prefix indices of L-type characters at bucket head, retain S-type only
-    // Bucket:  [ 0 0 0 0 (L-string) | 0 0 a b (S-string) ] --> [ 0 c 0 d (L-string) | 0 0 0 0 (S-string) ]
-    //          orig[a], orig[b] are L-type prefixes of LMS substrings.
-    //          All inductions from an LMS substring will be at larger indices,
-    //              because insertion occurs at head, and L-type implies later bucket.
-    //          If the L-prefix has an L-prefix: handled & reset later in the for-loop.
-    //          If the L-prefix has an S-prefix: bit-flipped     later in the for-loop.
-    //          orig[c], orig[d] are S-type prefixes of L-type strings.
-    memcpy(locs, head, memcpy_head_size);
+    else
     {
-        index_t odx = str_size - 1; // orig   index
-        token_t act = orig[odx--];  // active character: orig[str_size - 1] is L-type before '$'
-        token_t chk;                // check  character
-        index_t * loc = suffix + locs[act]; // bucket location: speed-up w.r.t. suffix[--locs[act]]
-        *loc++ = orig[odx] < act ? ~odx : odx;
-        for (index_t sdx = 0; sdx < str_size; ++sdx) // suffix index
-            if ((odx = suffix[sdx]) > 0) // L-type
+        // Step 1:  Place the L prefix indices of LMS substrings (i.e. index of preceding L-type character) at bucket tail
+        // Bucket:  [ 0 0 0 0 (L-string) | 0 0 0 0 (S-string) ] --> [ 0 0 0 0 (L-string) | 0 0 a b (S-string) ]
+        //          orig[a], orig[b] are L-type prefixes of LMS substrings
+        memcpy(locs, head + 1, memcpy_tail_size); locs[abc_size - 1] = str_size;
+        {
+            for (index_t sdx = 0; sdx < str_size; ++sdx) { suffix[sdx] = 0; }
+            for_each_lms_reverse(stype, str_size, [&](const index_t lms)
             {
-                if ((chk = orig[odx--]) != act)
+                suffix[--locs[orig[lms]]] = lms - 1; // Index of preceding L-type character
+            });
+        }
+        stats.step(1);
+
+        // Step 2:  Place the prefix indices of L-type characters at bucket head, retain S-type only
+        // Bucket:  [ 0 0 0 0 (L-string) | 0 0 a b (S-string) ] --> [ 0 c 0 d (L-string) | 0 0 0 0 (S-string) ]
+        //          orig[a], orig[b] are L-type prefixes of LMS substrings.
+        //          All inductions from an LMS substring will be at larger indices,
+        //              because insertion occurs at head, and L-type implies later bucket.
+        //          If the L-prefix has an L-prefix: handled & reset later in the for-loop.
+        //          If the L-prefix has an S-prefix: bit-flipped     later in the for-loop.
+        //          orig[c], orig[d] are S-type prefixes of L-type strings.
+        memcpy(locs, head, memcpy_head_size);
+        if (induce)
+        {
+            induce_lms_L<token_t, index_t>(orig, suffix, str_size, locs, *induce);
+        }
+        else
+        {
+            index_t odx = str_size - 1; // orig   index
+            token_t act = orig[odx--];  // active character: orig[str_size - 1] is L-type before '$'
+            token_t chk;                // check  character
+            index_t * loc = suffix + locs[act]; // bucket location: speed-up w.r.t. suffix[--locs[act]]
+            *loc++ = orig[odx] < act ? ~odx : odx;
+            for (index_t sdx = 0; sdx < str_size; ++sdx) // suffix index
+                if ((odx = suffix[sdx]) > 0) // L-type
                 {
-                    locs[act] = loc - suffix;
-                    loc = suffix + locs[act = chk];
+                    if ((chk = orig[odx--]) != act)
+                    {
+                        locs[act] = loc - suffix;
+                        loc = suffix + locs[act = chk];
+                    }
+                    *loc++ = orig[odx] < act ? ~odx : odx; // Index preceding L-type character
+                    suffix[sdx] = 0; // Reset
                 }
-                *loc++ = orig[odx] < act ? ~odx : odx; // Index preceding L-type character
-                suffix[sdx] = 0; // Reset
-            }
-            else if (odx < 0) // S-type becomes positive
-            {
-                suffix[sdx] = ~odx;
-            }
-    }
-
-    // Step 3:  Place the prefix indices of S-type characters at bucket tail, retain LMS only
-    // Bucket:  [ 0 c 0 d (L-string) | 0 0 0 0 (S-string) ] --> [ 0 0 0 0 (S-string) | 0 e f 0 (S-string) ]
-    //          orig[c], orig[d] are S-type prefixes of L-type strings
-    //          All inductions from L-type strings will be at smaller indices,
-    //              because insertion occurs at tail, and S-type implies earlier bucket.
-    //          If the S-prefix has an S-prefix: handled & reset later in the for-loop.
-    //          If the S-prefix has an L-prefix: set to LMS index (negative).
-    //          orig[e], orig[f] are initial characters of LMS substrings.    
-    memcpy(locs, head + 1, memcpy_tail_size); locs[abc_size - 1] = str_size;
-    {
-        index_t odx;     // orig index
-        token_t act = 0; // active character
-        token_t chk;     // check  character
-        index_t * loc = suffix + locs[act]; // bucket location: speed-up w.r.t. suffix[--locs[act]]
-        for (index_t sdx = str_size - 1; sdx >= 0; --sdx) // suffix index
-            if ((odx = suffix[sdx]) > 0) // Check for S-type
-            {
-                if ((chk = orig[odx--]) != act)
+                else if (odx < 0) // S-type becomes positive
                 {
-                    locs[act] = loc - suffix;
-                    loc = suffix + locs[act = chk];
+                    suffix[sdx] = ~odx;
                 }
-                *--loc = orig[odx] > act ? ~(odx + 1) : odx; // LMS negative with start index; S-type positive
-                suffix[sdx] = 0; // Reset
-            }
-    }
-
-    // All non-size one LMS prefixes and sentinel are sorted in SA: compute names for reduced problem
-    // Step 4: Move LMS odx to front
-    {
-        index_t lms = 0; // lms  index
-        index_t odx;     // orig index
-        // 2 * num_lms <= str_size, so while stops before lms == str_size
-        while ((odx = suffix[lms]) < 0) { suffix[lms++] = ~odx; }
-        if (lms < num_lms)
-            for (index_t sdx = lms + 1; sdx < str_size; ++sdx) // suffix index
-                if ((odx = suffix[sdx]) < 0)
+        }
+        stats.step(2);
+
+        // Step 3:  Place the prefix indices of S-type characters at bucket tail, retain LMS only
+        // Bucket:  [ 0 c 0 d (L-string) | 0 0 0 0 (S-string) ] --> [ 0 0 0 0 (S-string) | 0 e f 0 (S-string) ]
+        //          orig[c], orig[d] are S-type prefixes of L-type strings
+        //          All inductions from L-type strings will be at smaller indices,
+        //              because insertion occurs at tail, and S-type implies earlier bucket.
+        //          If the S-prefix has an S-prefix: handled & reset later in the for-loop.
+        //          If the S-prefix has an L-prefix: set to LMS index (negative).
+        //          orig[e], orig[f] are initial characters of LMS substrings.    
+        memcpy(locs, head + 1, memcpy_tail_size); locs[abc_size - 1] = str_size;
+        if (induce)
+        {
+            induce_lms_S<token_t, index_t>(orig, suffix, str_size, locs, *induce);
+        }
+        else
+        {
+            index_t odx;     // orig index
+            token_t act = 0; // active character
+            token_t chk;     // check  character
+            index_t * loc = suffix + locs[act]; // bucket location: speed-up w.r.t. suffix[--locs[act]]
+            for (index_t sdx = str_size - 1; sdx >= 0; --sdx) // suffix index
+                if ((odx = suffix[sdx]) > 0) // Check for S-type
                 {
-                    suffix[lms++] = ~odx;
-                    suffix[sdx] = 0;
+                    if ((chk = orig[odx--]) != act)
+                    {
+                        locs[act] = loc - suffix;
+                        loc = suffix + locs[act = chk];
+                    }
+                    *--loc = orig[odx] > act ? ~static_cast<index_t>(odx + 1) : odx; // LMS negative with start index; S-type positive
+                    suffix[sdx] = 0; // Reset
                 }
+        }
+        stats.step(3);
+
+        // All non-size one LMS prefixes and sentinel are sorted in SA: compute names for reduced problem
+        // Step 4: Move LMS odx to front
+        {
+            index_t lms = 0; // lms  index
+            index_t odx;     // orig index
+            // 2 * num_lms <= str_size, so while stops before lms == str_size
+            while ((odx = suffix[lms]) < 0) { suffix[lms++] = ~odx; }
+            if (lms < num_lms)
+                for (index_t sdx = lms + 1; sdx < str_size; ++sdx) // suffix index
+                    if ((odx = suffix[sdx]) < 0)
+                    {
+                        suffix[lms++] = ~odx;
+                        suffix[sdx] = 0;
+                    }
+        }
+        stats.step(4);
     }
 
     // Step 5: Store the length of LMS substring orig[odx] at suffix[num_lms + (odx >> 1)]
+    //         The length includes the next LMS character; the last LMS substring runs up to (excluding) '$'
     //         Character preceding or following LMS character cannot be LMS; 2 * num_lms <= str_size
     {
-        index_t odx = str_size - 1; // orig     index
-        index_t pdx = odx;          // previous index
-        token_t cur;                // current  character
-        token_t prv = orig[odx--];  // previous character: orig[str_size - 1] is L-type
-        while (odx > 0) // orig[0] cannot be LMS
+        index_t pdx = str_size - 1; // previous LMS index
+        for_each_lms_reverse(stype, str_size, [&](const index_t lms)
         {
-            while (odx >= 0 && (cur = orig[odx]) >= prv){ --odx; prv = cur; } // First S-type is cur = orig[odx]; prv L-type
-            while (odx >= 0 && (cur = orig[odx]) <= prv){ --odx; prv = cur; } // First L-type is cur = orig[odx]; prv S-type
-            if (odx >= 0)
-            {
-                suffix[num_lms + ((odx + 1) >> 1)] = pdx - odx;
-                pdx = odx;
-            }
-        }
+            suffix[num_lms + (lms >> 1)] = pdx - lms + 1;
+            pdx = lms;
+        });
     }
+    stats.step(5);
 
     // Step 6: Compute names
     //    - odx = suffix[sdx < num_lms] are ordered LMS substrings
@@ -185,13 +256,21 @@ void sais_implementation(const token_t * orig, const index_t abc_size, index_t *
             cur_pos = suffix[lms];
             cur_len = suffix[num_lms + (cur_pos >> 1)];
             diff = true;
-            if (cur_len == prv_len) // Any LMS (except for '$' with length 0) has length at least two
+            if (cur_len == prv_len && prv_pos + prv_len < str_size) // Any LMS (except for '$' with length 0) has length at least two;
+                                                                    // the LMS substring ending with '$' is unique
             {
-                for (odx = 0; odx < prv_len && orig[cur_pos + odx] == orig[prv_pos + odx]; ++odx) { }
-                if (odx == prv_len) { diff = false; }
+                if (name_words)
+                {
+                    if (equal_text(orig, cur_pos, prv_pos, prv_len)) { diff = false; }
+                }
+                else
+                {
+                    for (odx = 0; odx < prv_len && orig[cur_pos + odx] == orig[prv_pos + odx]; ++odx) { }
+                    if (odx == prv_len) { diff = false; }
+                }
             }
             /*
-                The above is faster than:
+                The token loop is faster than:
                     bool same = cur_len == prv_len;
                     for (index_t odx = 0; same && odx < prv_len; ++odx)
                         same = orig[cur_pos + odx] == orig[prv_pos + odx];
@@ -206,15 +285,21 @@ void sais_implementation(const token_t * orig, const index_t abc_size, index_t *
             suffix[num_lms + (cur_pos >> 1)] = name;
         }
     }
+    stats.names(static_cast<int64_t>(num_lms), static_cast<int64_t>(name));
+    stats.step(6);
 
     // Step 7: Solve recursion problem
     //         2 * (name - 1) < 2 * num_lms <= str_size (index_t)
     //         --> data_bytes <= index_bytes <= sizeof(index_t)
+    //         data_bytes resp. index_bytes == 8 stands for the full width: the recursion then uses
+    //         unsigned_index<index_t>::type resp. index_t (uint64_t resp. int64_t, or packed 40-bit)
+    typedef typename unsigned_index<index_t>::type wide_t;
     const index_t bound = str_size & static_cast<index_t>(1) ? (str_size >> 1) + 1 : (str_size >> 1);
     uint8_t index_bytes = 255;
     if (name == num_lms)
     {
-        index_bytes = sizeof(index_t);
+        index_bytes = 8; // suffix[0:num_lms] holds index_t
+        stats.dispatch(0, sizeof(index_t));
         index_t * source = suffix + num_lms;
         index_t lms = 0;
         for (index_t sdx = 0; sdx < bound; ++sdx)
@@ -229,59 +314,53 @@ void sais_implementation(const token_t * orig, const index_t abc_size, index_t *
         index_bytes = static_cast<size_t>(num_lms) <= static_cast<size_t>( INT8_MAX) ? 1 :
                      (static_cast<size_t>(num_lms) <= static_cast<size_t>(INT16_MAX) ? 2 :
                      (static_cast<size_t>(num_lms) <= static_cast<size_t>(INT32_MAX) ? 4 : 8));
+        stats.dispatch(data_bytes == 8 ? sizeof(wide_t) : data_bytes, index_bytes == 8 ? sizeof(index_t) : index_bytes);
         if (data_bytes == 8)
         {
-            // str_size > num_lms > name - 1 > UINT32_MAX > INT32_MAX: recursion index_t (for num_lms) can only be int64_t
-            sais_recursion<index_t, uint64_t, int64_t>(suffix, str_size, num_lms, name, bound);
+            // str_size > num_lms > name - 1 > UINT32_MAX > INT32_MAX: recursion index_t (for num_lms) can only be the full width
+            sais_recursion<index_t, wide_t, index_t>(suffix, str_size, num_lms, name, bound, num_threads, engine);
         }
         else if (data_bytes == 4)
         {
             // str_size > num_lms > name - 1 > UINT16_MAX > INT16_MAX: recursion index_t (for num_lms) can only be int32_t or int64_t
             if (index_bytes == 8)
-                sais_recursion<index_t, uint32_t, int64_t>(suffix, str_size, num_lms, name, bound);
+                sais_recursion<index_t, uint32_t, index_t>(suffix, str_size, num_lms, name, bound, num_threads, engine);
             else // index_bytes == 4
-                sais_recursion<index_t, uint32_t, int32_t>(suffix, str_size, num_lms, name, bound);
+                sais_recursion<index_t, uint32_t, int32_t>(suffix, str_size, num_lms, name, bound, num_threads, engine);
         }
         else if (data_bytes == 2)
         {
             // str_size > num_lms > name - 1 > UINT8_MAX > INT8_MAX: recursion index_t (for num_lms) can only be int16_t, int32_t or int64_t
             if (index_bytes == 8)
-                sais_recursion<index_t, uint16_t, int64_t>(suffix, str_size, num_lms, name, bound);
+                sais_recursion<index_t, uint16_t, index_t>(suffix, str_size, num_lms, name, bound, num_threads, engine);
             else if (index_bytes == 4)
-                sais_recursion<index_t, uint16_t, int32_t>(suffix, str_size, num_lms, name, bound);
+                sais_recursion<index_t, uint16_t, int32_t>(suffix, str_size, num_lms, name, bound, num_threads, engine);
             else // index_bytes == 2
-                sais_recursion<index_t, uint16_t, int16_t>(suffix, str_size, num_lms, name, bound);
+                sais_recursion<index_t, uint16_t, int16_t>(suffix, str_size, num_lms, name, bound, num_threads, engine);
         }
         else // if (data_bytes == 1)
         {
             if (index_bytes == 8)
-                sais_recursion<index_t, uint8_t, int64_t>(suffix, str_size, num_lms, name, bound);
+                sais_recursion<index_t, uint8_t, index_t>(suffix, str_size, num_lms, name, bound, num_threads, engine);
             else if (index_bytes == 4)
-                sais_recursion<index_t, uint8_t, int32_t>(suffix, str_size, num_lms, name, bound);
+                sais_recursion<index_t, uint8_t, int32_t>(suffix, str_size, num_lms, name, bound, num_threads, engine);
             else if (index_bytes == 2)
-                sais_recursion<index_t, uint8_t, int16_t>(suffix, str_size, num_lms, name, bound);
+                sais_recursion<index_t, uint8_t, int16_t>(suffix, str_size, num_lms, name, bound, num_threads, engine);
             else // index_bytes == 1
-                sais_recursion<index_t, uint8_t, int8_t>(suffix, str_size, num_lms, name, bound);
+                sais_recursion<index_t, uint8_t, int8_t>(suffix, str_size, num_lms, name, bound, num_threads, engine);
         }
     }
+    stats.step(7);
 
     // Step 8: Build suffix[lms] = P1[SA1[lms]]
     {
         index_t * P1 = suffix + num_lms;
-        index_t odx = str_size - 1;
         index_t lms = num_lms;
-        token_t cur;
-        token_t prv = orig[odx--]; // orig[str_size - 1] is L-type
-        while (odx > 0) // orig[0] cannot be LMS
-        {
-            while (odx >= 0 && (cur = orig[odx]) >= prv){ --odx; prv = cur; } // First S-type is cur = orig[odx]; prv L-type
-            while (odx >= 0 && (cur = orig[odx]) <= prv){ --odx; prv = cur; } // First L-type is cur = orig[odx]; prv S-type
-            if (odx >= 0)
-                P1[--lms] = odx + 1;
-        }
+        for_each_lms_reverse(stype, str_size, [&](const index_t odx){ P1[--lms] = odx; });
+        if (!work3) { sais_delete(stype, stype_words); }
         if (index_bytes == 8)
         {
-            int64_t * SA1 = reinterpret_cast<int64_t *>(suffix);
+            index_t * SA1 = suffix;
             for (index_t lms = num_lms - 1; lms >= 0; --lms)
                 suffix[lms] = P1[SA1[lms]];
         }
@@ -304,6 +383,7 @@ void sais_implementation(const token_t * orig, const index_t abc_size, index_t *
                 suffix[lms] = P1[SA1[lms]];
         }
     }
+    stats.step(8);
 
     // Step 9: Place the LMS characters at their bucket tails
     //         Assumes the LMS indices are in correct order stored in suffix[0:num_lms];
@@ -311,7 +391,7 @@ void sais_implementation(const token_t * orig, const index_t abc_size, index_t *
     memcpy(locs, head + 1, memcpy_tail_size); locs[abc_size - 1] = str_size;
     {
         index_t lms = num_lms - 1; // lms    index
-        index_t odx = suffix[lms]; // orig   index
+        index_t odx = num_lms > 0 ? suffix[lms] : static_cast<index_t>(0); // orig index: no LMS if orig is non-increasing after its S-prefix
         index_t sdx = str_size;    // suffix index
         token_t act;               // active character
         token_t chk = orig[odx];   // check  character
@@ -330,6 +410,7 @@ void sais_implementation(const token_t * orig, const index_t abc_size, index_t *
         }
         while (sdx > 0) { suffix[--sdx] = 0; }
     }
+    stats.step(9);
 
     // Step 10:  Place the indices of L-type characters at bucket head
     // Bucket:  [ 0 0 0 0 (L-string) | 0 0 a b (S-string) ] --> [ c d e f (L-string) | 0 0 a b (S-string) ]
@@ -339,6 +420,38 @@ void sais_implementation(const token_t * orig, const index_t abc_size, index_t *
     // After:   orig[c:], orig[d:], orig[e:], orig[f:] are induced L-type strings.
     //          a, b, c, d, e, f < 0 if they induce L-type; a, b, c, d, e, f > 0 if they induce S-type.
     memcpy(locs, head, memcpy_head_size);
+    if (induce)
+    {
+        induce_final_L<token_t, index_t>(orig, suffix, str_size, locs, *induce, primary);
+    }
+    else if (primary) // BWT: the index of an L-inducer is not needed anymore after its induction
+    {
+        index_t odx = str_size - 1; // orig   index
+        token_t act = orig[odx];    // active character: orig[str_size - 1] is L-type before '$'
+        token_t chk;                // check  character
+        index_t * loc = suffix + locs[act]; // bucket location: speed-up w.r.t. suffix[--locs[act]]
+        *loc++ = odx > 0 && orig[odx - 1] < act ? ~odx : odx; // < 0 resp. > 0 means it induces S-type resp. L-type
+        for (index_t sdx = 0; sdx < str_size; ++sdx) // suffix index
+        {
+            odx = suffix[sdx];
+            if (odx > 0) // L-type
+            {
+                if ((chk = orig[--odx]) != act)
+                {
+                    locs[act] = loc - suffix;
+                    loc = suffix + locs[act = chk];
+                }
+                suffix[sdx] = ~static_cast<index_t>(chk); // BWT character, positive after Step 11
+                if (odx == 0){ *primary = loc - suffix; }
+                *loc++ = odx > 0 && orig[odx - 1] < act ? ~odx : odx;
+            }
+            else
+            {
+                suffix[sdx] = ~odx; // S-type positive
+            }
+        }
+    }
+    else
     {
         index_t odx = str_size - 1; // orig   index
         token_t act = orig[odx];    // active character: orig[str_size - 1] is L-type before '$'
@@ -360,6 +473,7 @@ void sais_implementation(const token_t * orig, const index_t abc_size, index_t *
             }
         }
     }
+    stats.step(10);
 
     // Step 11: Place the indices of S-type characters at bucket tail
     // Bucket:  [ c d e f (L-string) | 0 0 a b (S-string) ] --> [ c d e f (L-string) | g h i j (S-string) ]
@@ -367,6 +481,41 @@ void sais_implementation(const token_t * orig, const index_t abc_size, index_t *
     //          Inductions will be at earlier indices, because insertions at tail, and S-type implies earlier.
     // After:   all indices >= 0.
     memcpy(locs, head + 1, memcpy_tail_size); locs[abc_size - 1] = str_size;
+    if (induce)
+    {
+        induce_final_S<token_t, index_t>(orig, suffix, str_size, locs, *induce, primary);
+    }
+    else if (primary) // BWT: an induced S-type index with L-type prefix only needs its BWT character
+    {
+        index_t odx;     // orig   index
+        token_t act = 0; // active character
+        token_t chk;     // check  character
+        index_t * loc = suffix + locs[act]; // bucket location: speed-up w.r.t. suffix[--locs[act]]
+        for (index_t sdx = str_size - 1; sdx >= 0; --sdx) // suffix index
+            if ((odx = suffix[sdx]) > 0) // S-type
+            {
+                if ((chk = orig[--odx]) != act)
+                {
+                    locs[act] = loc - suffix;
+                    loc = suffix + locs[act = chk];
+                }
+                suffix[sdx] = static_cast<index_t>(chk); // BWT character
+                if (odx == 0)
+                {
+                    *--loc = ~odx;
+                    *primary = loc - suffix;
+                }
+                else
+                {
+                    *--loc = orig[odx - 1] > act ? ~static_cast<index_t>(orig[odx - 1]) : odx; // BWT character negative, S-type positive
+                }
+            }
+            else
+            {
+                suffix[sdx] = ~odx; // Make BWT characters positive
+            }
+    }
+    else
     {
         index_t odx;     // orig   index
         token_t act = 0; // active character
@@ -388,13 +537,16 @@ void sais_implementation(const token_t * orig, const index_t abc_size, index_t *
             }
     }
 
-    if (!work1) { delete [] head; }
-    if (!work2) { delete [] locs; }
+    stats.step(11);
+
+    if (induce) { delete induce; }
+    if (!work2 && fixed_abc == 0) { sais_delete(locs, static_cast<size_t>(abc_size)); }
+    if (!work1 && fixed_abc == 0) { sais_delete(head, static_cast<size_t>(abc_size)); }
 }
 
 
 template <class index_t, class data_t, class idx_t>
-void sais_recursion(index_t * suffix, const index_t str_size, const index_t num_lms, const index_t name, const index_t bound)
+void sais_recursion(index_t * suffix, const index_t str_size, const index_t num_lms, const index_t name, const index_t bound, const int num_threads, const sais_engine engine)
 {
     int8_t * buffer  = reinterpret_cast<int8_t *>(suffix);
     size_t space_bfr = sizeof(index_t) * static_cast<size_t>(str_size);
@@ -408,24 +560,241 @@ void sais_recursion(index_t * suffix, const index_t str_size, const index_t num_
       idx_t * work1 = space_sa1 + space_s1 +     space_w12 <= space_bfr ? reinterpret_cast<idx_t *>(buffer + space_sa1 + space_s1) : NULL;
       idx_t * work2 = space_sa1 + space_s1 + 2 * space_w12 <= space_bfr ? work1 + name : NULL;
 
+    // Type bitmap of the recursion in the tail of suffix, after work2 and aligned to 8 bytes
+    size_t space_w3  = sizeof(uint64_t) * (static_cast<size_t>(num_lms) / 64 + 1);
+    size_t start_w3  = space_sa1 + space_s1 + 2 * space_w12;
+    start_w3 += (8 - reinterpret_cast<uintptr_t>(buffer + start_w3) % 8) % 8;
+   uint64_t * work3 = work2 && start_w3 + space_w3 <= space_bfr ? reinterpret_cast<uint64_t *>(buffer + start_w3) : NULL;
+
     index_t lms = 0;
     for (index_t sdx = 0; sdx < bound; ++sdx)
         if (src[sdx] > 0)
             S1[lms++] = static_cast<data_t>(src[sdx] - 1);
 
-    sais_implementation<data_t, idx_t>(S1, static_cast<idx_t>(name), SA1, static_cast<idx_t>(num_lms), work1, work2);
+    sais_implementation<data_t, idx_t>(static_cast<const data_t *>(S1), static_cast<idx_t>(name), SA1, static_cast<idx_t>(num_lms), work1, work2, num_threads, NULL, engine, work3);
 }
 
 
 void sais(const uint8_t * orig, int64_t * suffix, const int64_t size)
 {
-    sais_implementation<uint8_t, int64_t>(orig, 256, suffix, size, NULL, NULL);
+    sais_implementation<uint8_t, int64_t>(orig, 256, suffix, size, NULL, NULL, 1, NULL);
 }
 
 
 void sais(const uint8_t * orig, int32_t * suffix, const int32_t size)
 {
-    sais_implementation<uint8_t, int32_t>(orig, 256, suffix, size, NULL, NULL);
+    sais_implementation<uint8_t, int32_t>(orig, 256, suffix, size, NULL, NULL, 1, NULL);
+}
+
+
+/*
+    Packed 40-bit suffix array (5 bytes per suffix) for texts of 2 GB up to 2^39 - 1 bytes (int40_max):
+    larger sizes throw std::length_error, as the int40_t overloads below
+*/
+void sais_int40_limit(const int64_t size)
+{
+    if (size > int40_max)
+        throw std::length_error("aiss4::sais: int40_t suffix arrays hold at most 2^39 - 1 suffixes");
+}
+
+
+void sais(const uint8_t * orig, int40_t * suffix, const int64_t size)
+{
+    sais_int40_limit(size);
+    sais_implementation<uint8_t, int40_t>(orig, 256, suffix, size, NULL, NULL, 1, NULL);
+}
+
+
+/*
+    Multi-threaded induction sweeps: identical result to the serial sais
+*/
+void sais(const uint8_t * orig, int64_t * suffix, const int64_t size, const int num_threads)
+{
+    sais_implementation<uint8_t, int64_t>(orig, 256, suffix, size, NULL, NULL, num_threads, NULL);
+}
+
+
+void sais(const uint8_t * orig, int32_t * suffix, const int32_t size, const int num_threads)
+{
+    sais_implementation<uint8_t, int32_t>(orig, 256, suffix, size, NULL, NULL, num_threads, NULL);
+}
+
+
+void sais(const uint8_t * orig, int40_t * suffix, const int64_t size, const int num_threads)
+{
+    sais_int40_limit(size);
+    sais_implementation<uint8_t, int40_t>(orig, 256, suffix, size, NULL, NULL, num_threads, NULL);
+}
+
+
+/*
+    Sort of the LMS substrings by engine (src/sais_engine.hpp): engine_induce as sais, engine_twostage
+    or engine_auto, with the same result
+*/
+void sais(const uint8_t * orig, int64_t * suffix, const int64_t size, const int num_threads, const sais_engine engine)
+{
+    sais_implementation<uint8_t, int64_t>(orig, 256, suffix, size, NULL, NULL, num_threads, NULL, engine);
+}
+
+
+void sais(const uint8_t * orig, int32_t * suffix, const int32_t size, const int num_threads, const sais_engine engine)
+{
+    sais_implementation<uint8_t, int32_t>(orig, 256, suffix, size, NULL, NULL, num_threads, NULL, engine);
+}
+
+
+void sais(const uint8_t * orig, int40_t * suffix, const int64_t size, const int num_threads, const sais_engine engine)
+{
+    sais_int40_limit(size);
+    sais_implementation<uint8_t, int40_t>(orig, 256, suffix, size, NULL, NULL, num_threads, NULL, engine);
+}
+
+
+/*
+    Bucket arrays and type bitmap of sais_implementation, kept across calls of the templated sais.
+    They come from the allocator attached when they are reserved, which also releases them.
+*/
+template <class index_t>
+class sais_workspace
+{
+    public:
+
+        sais_workspace() : size(0), head(NULL), locs(NULL), words(0), types(NULL), owner(NULL) {}
+
+        sais_workspace(const sais_workspace &) = delete;
+
+        sais_workspace & operator=(const sais_workspace &) = delete;
+
+        ~sais_workspace()
+        {
+            release();
+        }
+
+        // Grow the bucket arrays to at least abc_size entries, and the type bitmap to texts of str_size
+        void reserve(const index_t abc_size, const index_t str_size = 0)
+        {
+            const size_t need = static_cast<size_t>(str_size) / 64 + 1;
+            if (abc_size <= size && need <= words)
+                return;
+            const index_t new_size  = abc_size > size ? abc_size : size;
+            const size_t  new_words = need > words ? need : words;
+            release();
+            owner = sais_allocator_current;
+            head  = sais_new<index_t>(static_cast<size_t>(new_size));
+            locs  = sais_new<index_t>(static_cast<size_t>(new_size));
+            types = sais_new<uint64_t>(new_words);
+            size  = new_size;
+            words = new_words;
+        }
+
+        index_t    size;
+        index_t  * head;
+        index_t  * locs;
+        size_t     words;
+        uint64_t * types;
+
+    private:
+
+        void release()
+        {
+            if (size == 0)
+                return;
+            sais_allocator * previous = sais_allocator_attach(owner);
+            sais_delete(types, words);
+            sais_delete(locs, static_cast<size_t>(size));
+            sais_delete(head, static_cast<size_t>(size));
+            sais_allocator_attach(previous);
+            size  = 0;
+            head  = NULL;
+            locs  = NULL;
+            words = 0;
+            types = NULL;
+        }
+
+        sais_allocator * owner;
+
+};
+
+
+/*
+    Integer alphabet: orig[odx] < abc_size is required for all odx, for unsigned token_t
+    (e.g. uint16_t word IDs or uint32_t k-mer codes) and signed index_t (int32_t or int64_t).
+    The bucket arrays and type bitmap of the top level come from workspace, which can be reused
+    across calls.
+*/
+template <class token_t, class index_t>
+void sais(const token_t * orig, const index_t abc_size, index_t * suffix, const index_t size, sais_workspace<index_t> & workspace, const int num_threads)
+{
+    const index_t num_buckets = abc_size < 2 ? static_cast<index_t>(2) : abc_size; // a unary text is sorted as any other
+    workspace.reserve(num_buckets, size);
+    sais_implementation<token_t, index_t>(orig, num_buckets, suffix, size, workspace.head, workspace.locs, num_threads, NULL, engine_induce, workspace.types);
+}
+
+
+template <class token_t, class index_t>
+void sais(const token_t * orig, const index_t abc_size, index_t * suffix, const index_t size, sais_workspace<index_t> & workspace)
+{
+    sais<token_t, index_t>(orig, abc_size, suffix, size, workspace, 1);
+}
+
+
+/*
+    BWT without the suffix array: the final induction sweeps write the BWT characters into suffix,
+    which is only used as workspace. The result in encoded (which may be orig) and the returned
+    pointer are identical to encode(orig, suffix, encoded, size) after sais(orig, suffix, size).
+*/
+template <class index_t>
+index_t sais_bwt_implementation(const uint8_t * orig, uint8_t * encoded, index_t * suffix, const index_t size, const int num_threads, const sais_engine engine)
+{
+    if (size < 1 || orig == NULL || encoded == NULL || suffix == NULL)
+        return -1;
+
+    const uint8_t last = orig[size - 1];
+    index_t primary = 0;
+    sais_implementation<uint8_t, index_t>(orig, 256, suffix, size, NULL, NULL, num_threads, &primary, engine);
+
+    encoded[0] = last;
+    for (index_t sdx = 0; sdx < primary; ++sdx)
+        encoded[sdx + 1] = static_cast<uint8_t>(suffix[sdx]);
+    for (index_t sdx = primary + 1; sdx < size; ++sdx)
+        encoded[sdx] = static_cast<uint8_t>(suffix[sdx]);
+    return primary + 1;
+}
+
+
+int64_t sais_bwt(const uint8_t * orig, uint8_t * encoded, int64_t * suffix, const int64_t size)
+{
+    return sais_bwt_implementation<int64_t>(orig, encoded, suffix, size, 1, engine_induce);
+}
+
+
+int32_t sais_bwt(const uint8_t * orig, uint8_t * encoded, int32_t * suffix, const int32_t size)
+{
+    return sais_bwt_implementation<int32_t>(orig, encoded, suffix, size, 1, engine_induce);
+}
+
+
+int64_t sais_bwt(const uint8_t * orig, uint8_t * encoded, int64_t * suffix, const int64_t size, const int num_threads)
+{
+    return sais_bwt_implementation<int64_t>(orig, encoded, suffix, size, num_threads, engine_induce);
+}
+
+
+int32_t sais_bwt(const uint8_t * orig, uint8_t * encoded, int32_t * suffix, const int32_t size, const int num_threads)
+{
+    return sais_bwt_implementation<int32_t>(orig, encoded, suffix, size, num_threads, engine_induce);
+}
+
+
+int64_t sais_bwt(const uint8_t * orig, uint8_t * encoded, int64_t * suffix, const int64_t size, const int num_threads, const sais_engine engine)
+{
+    return sais_bwt_implementation<int64_t>(orig, encoded, suffix, size, num_threads, engine);
+}
+
+
+int32_t sais_bwt(const uint8_t * orig, uint8_t * encoded, int32_t * suffix, const int32_t size, const int num_threads, const sais_engine engine)
+{
+    return sais_bwt_implementation<int32_t>(orig, encoded, suffix, size, num_threads, engine);
 }
 
 
@@ -0,0 +1,224 @@
+/*
+    aiss4: suffix array via induced sorting
+
+    Copyright (c) 2020, Sebastian Wouters
+    All rights reserved.
+
+    This file is part of aiss4, licensed under the BSD 3-Clause License.
+    A copy of the License can be found in the file LICENSE in the root
+    folder of this project.
+*/
+
+#pragma once
+
+#include "sais.hpp"
+#include "rank.hpp"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace aiss4
+{
+
+
+const int append_insert_ratio = 4; // sais_append inserts chunks of m characters when append_insert_ratio * m * log2(n) < n
+
+
+/*
+    T[size - len:size] occurs at another offset of T = orig[0:size], by binary search in its suffix array
+*/
+template <class index_t>
+bool repeated_suffix(const uint8_t * orig, const index_t * suffix, const index_t size, const index_t len)
+{
+    if (len == 0)
+        return true;
+    const uint8_t * ptrn = orig + size - len;
+    index_t lo = 0; // first suffix >= ptrn, which is ptrn itself
+    index_t hi = size;
+    while (lo < hi)
+    {
+        const index_t mid = lo + (hi - lo) / 2;
+        const index_t odx = suffix[mid];
+        const index_t cmp_len = size - odx < len ? size - odx : len;
+        const int cmp = memcmp(orig + odx, ptrn, cmp_len);
+        if (cmp < 0 || (cmp == 0 && cmp_len < len)){ lo = mid + 1; } else { hi = mid; }
+    }
+    if (lo + 1 >= size)
+        return false;
+    const index_t odx = suffix[lo + 1]; // ptrn occurs elsewhere iff it is a prefix of the next suffix
+    return size - odx >= len && memcmp(orig + odx, ptrn, len) == 0;
+}
+
+
+/*
+    Suffix array of orig[0:new_size] in suffix[0:new_size], given the suffix array of orig[0:old_size]
+    in suffix[0:old_size]. Same result as sais(orig, suffix, new_size).
+
+    With T = orig[0:old_size], X = orig[old_size:new_size] and L the length of the longest suffix of T
+    which also occurs at another offset of T (a repeated suffix):
+
+    1. L by galloping and binary search with the suffix array of T: O(L log(n) log(L)).
+    2. The suffixes of T[i:]X for i < start = old_size - L keep their order: the shorter of two has
+       more than L characters, so it is no prefix of the other and T decides. The suffixes of the
+       chunk C = T[start:]X are sorted with sais (C is X, plus the repeated tail of T, for which the
+       order may change as in T = aa, X = b). The suffix array of T is compacted to the offsets
+       < start.
+    3. Gap array: the number of suffixes T[i:]X in between consecutive chunk suffixes, either
+       - by inserting the chunk suffixes in suffix array order into the compacted suffix array, with
+         galloping from the previous one and string comparisons: O(m log(n / m)) comparisons, for
+         chunks of m characters with m log2(n) < n / 4 (append_insert_ratio), or
+       - by backward search of T[i:]X with the BWT of C, from i = start - 1 down to 0, as in Step 3
+         of sais_external: n rank queries, without long comparisons in repetitive texts.
+    4. The compacted suffix array of T and the one of C are merged in place from the back.
+
+    Time: sais of C, Step 3, and one streaming pass over the suffix array. Memory: about
+    2 sizeof(index_t) + 1 bytes per chunk character next to orig and suffix, plus 5 bytes per chunk
+    character for the backward search.
+*/
+template <class index_t>
+void sais_append_implementation(const uint8_t * orig, index_t * suffix, const index_t old_size, const index_t new_size, const int num_threads)
+{
+    if (orig == NULL || suffix == NULL || new_size <= old_size)
+        return;
+
+    // Step 1: Longest repeated suffix of T
+    index_t rep = 0;
+    if (old_size > 1)
+    {
+        index_t lo = 0; // repeated
+        index_t hi = 1;
+        while (hi < old_size && repeated_suffix(orig, suffix, old_size, hi))
+        {
+            lo = hi;
+            hi = hi < old_size / 2 ? 2 * hi : old_size; // T itself occurs only once
+        }
+        while (hi - lo > 1) // repeated(lo) and not repeated(hi)
+        {
+            const index_t mid = lo + (hi - lo) / 2;
+            if (repeated_suffix(orig, suffix, old_size, mid)){ lo = mid; } else { hi = mid; }
+        }
+        rep = lo;
+    }
+    const index_t start = old_size - rep;
+    const index_t len   = new_size - start;
+    const uint8_t * chunk = orig + start;
+
+    // Step 2: Sort the chunk suffixes, and compact the suffix array of T
+    index_t * chunk_sa = new index_t[len];
+    sais(chunk, chunk_sa, len, num_threads);
+    index_t kept = 0;
+    for (index_t sdx = 0; sdx < old_size; ++sdx)
+    {
+        if (suffix[sdx] < start)
+            suffix[kept++] = suffix[sdx];
+    }
+
+    // Step 3: Gap array: gap[sdx] suffixes of T[0:start]X fall in between chunk suffixes sdx - 1 and sdx
+    index_t * gap = new index_t[len + 1];
+    for (index_t sdx = 0; sdx <= len; ++sdx){ gap[sdx] = 0; }
+    int log_size = 1;
+    while (log_size < 62 && (static_cast<int64_t>(1) << log_size) < static_cast<int64_t>(start)){ ++log_size; }
+    if (static_cast<int64_t>(append_insert_ratio) * len * log_size < static_cast<int64_t>(start))
+    {
+        // T[odx:]X < orig[pos:new_size] for odx < pos: the chunk suffix is shorter, and smaller if it is a prefix
+        auto smaller = [&](const index_t odx, const index_t pos){ return memcmp(orig + odx, orig + pos, new_size - pos) < 0; };
+        index_t prv = 0; // number of suffixes of T[0:start]X smaller than the previous chunk suffix
+        for (index_t sdx = 0; sdx < len; ++sdx)
+        {
+            const index_t pos = start + chunk_sa[sdx];
+            index_t lo   = prv; // smaller for the suffixes before lo
+            index_t hi   = prv;
+            index_t step = 1;
+            while (hi < kept && smaller(suffix[hi], pos))
+            {
+                lo = hi + 1;
+                hi = kept - hi > step ? hi + step : kept;
+                step *= 2;
+            }
+            while (lo < hi) // smaller before lo, not smaller from hi
+            {
+                const index_t mid = lo + (hi - lo) / 2;
+                if (smaller(suffix[mid], pos)){ lo = mid + 1; } else { hi = mid; }
+            }
+            gap[sdx] = lo - prv;
+            prv = lo;
+        }
+        gap[len] = kept - prv;
+    }
+    else if (start > 0)
+    {
+        uint8_t * bwt  = new uint8_t[len];
+        index_t   hole = 0; // rank of C itself, without preceding chunk character
+        index_t   head[256] = { };
+        for (index_t sdx = 0; sdx < len; ++sdx)
+        {
+            const index_t odx = chunk_sa[sdx];
+            if (odx == 0)
+            {
+                hole = sdx;
+                bwt[sdx] = 0;
+            }
+            else
+            {
+                bwt[sdx] = chunk[odx - 1];
+            }
+        }
+        {
+            index_t count[256] = { };
+            for (index_t idx = 0; idx < len; ++idx){ ++count[chunk[idx]]; }
+            for (int chr = 1; chr < 256; ++chr){ head[chr] = head[chr - 1] + count[chr - 1]; }
+        }
+
+        byte_rank_compact ranks(bwt, static_cast<size_t>(len), 7);
+        const uint8_t last = chunk[len - 1]; // precedes the empty suffix, which is smaller than any T[i:]X
+        index_t rank = hole; // number of chunk suffixes smaller than T[i + 1:]X
+        for (index_t odx = start - 1; odx >= 0; --odx)
+        {
+            const uint8_t chr = orig[odx];
+            rank = head[chr] + static_cast<index_t>(ranks.rank(chr, static_cast<size_t>(rank))) - (chr == 0 && rank > hole ? 1 : 0) + (chr == last ? 1 : 0);
+            ++gap[rank];
+        }
+        delete [] bwt;
+    }
+
+    // Step 4: Merge from the back
+    index_t tdx = kept;
+    index_t wdx = new_size;
+    for (index_t sdx = len; sdx >= 0; --sdx)
+    {
+        if (sdx < len){ suffix[--wdx] = start + chunk_sa[sdx]; }
+        for (index_t cnt = 0; cnt < gap[sdx]; ++cnt){ suffix[--wdx] = suffix[--tdx]; }
+    }
+
+    delete [] chunk_sa;
+    delete [] gap;
+}
+
+
+void sais_append(const uint8_t * orig, int32_t * suffix, const int32_t old_size, const int32_t new_size, const int num_threads)
+{
+    sais_append_implementation<int32_t>(orig, suffix, old_size, new_size, num_threads);
+}
+
+
+void sais_append(const uint8_t * orig, int64_t * suffix, const int64_t old_size, const int64_t new_size, const int num_threads)
+{
+    sais_append_implementation<int64_t>(orig, suffix, old_size, new_size, num_threads);
+}
+
+
+void sais_append(const uint8_t * orig, int32_t * suffix, const int32_t old_size, const int32_t new_size)
+{
+    sais_append_implementation<int32_t>(orig, suffix, old_size, new_size, 1);
+}
+
+
+void sais_append(const uint8_t * orig, int64_t * suffix, const int64_t old_size, const int64_t new_size)
+{
+    sais_append_implementation<int64_t>(orig, suffix, old_size, new_size, 1);
+}
+
+
+} // End of namespace aiss4
+
@@ -0,0 +1,61 @@
+/*
+    aiss4: suffix array via induced sorting
+
+    Copyright (c) 2020, Sebastian Wouters
+    All rights reserved.
+
+    This file is part of aiss4, licensed under the BSD 3-Clause License.
+    A copy of the License can be found in the file LICENSE in the root
+    folder of this project.
+*/
+
+#pragma once
+
+#include "sais.hpp"
+#include "parallel.hpp"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+namespace aiss4
+{
+
+
+/*
+    Suffix arrays of num_records independent records orig[offsets[rec]:offsets[rec + 1]]:
+    suffix[offsets[rec] + sdx] is the sdx-th smallest suffix of record rec, relative to its start.
+
+    The records are spread over num_threads threads with work stealing (parallel_tasks). Each
+    thread keeps its own sais_workspace, and the alphabet of a record is cut to its largest
+    character, so that short records do not pay for 256 buckets in every pass.
+    Returns false if the offsets are not non-decreasing or a record exceeds INT32_MAX.
+*/
+bool sais_batch(const uint8_t * orig, const int64_t * offsets, const int64_t num_records, int32_t * suffix, const int num_threads)
+{
+    if (num_records < 0 || (num_records > 0 && (orig == NULL || offsets == NULL || suffix == NULL)))
+        return false;
+    for (int64_t rec = 0; rec < num_records; ++rec)
+        if (offsets[rec + 1] < offsets[rec] || offsets[rec + 1] - offsets[rec] > INT32_MAX)
+            return false;
+
+    const int threads = num_threads < 1 ? 1 : num_threads;
+    sais_workspace<int32_t> * workspaces = new sais_workspace<int32_t>[threads];
+    for (int thr = 0; thr < threads; ++thr)
+        workspaces[thr].reserve(256);
+
+    parallel_tasks(threads, num_records, [orig, offsets, suffix, workspaces](const int64_t rec, const int thr)
+        {
+            const uint8_t * text = orig + offsets[rec];
+            const int32_t   size = static_cast<int32_t>(offsets[rec + 1] - offsets[rec]);
+            uint8_t largest = 0;
+            for (int32_t odx = 0; odx < size; ++odx)
+                largest = text[odx] > largest ? text[odx] : largest;
+            sais<uint8_t, int32_t>(text, static_cast<int32_t>(largest) + 1, suffix + offsets[rec], size, workspaces[thr]);
+        });
+
+    delete [] workspaces;
+    return true;
+}
+
+
+} // End of namespace aiss4
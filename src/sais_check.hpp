@@ -0,0 +1,199 @@
+/*
+    aiss4: suffix array via induced sorting
+
+    Copyright (c) 2020, Sebastian Wouters
+    All rights reserved.
+
+    This file is part of aiss4, licensed under the BSD 3-Clause License.
+    A copy of the License can be found in the file LICENSE in the root
+    folder of this project.
+*/
+
+#pragma once
+
+#include "rank.hpp"
+#include "int40.hpp"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+namespace aiss4
+{
+
+
+/*
+    Checks that suffix[0:size] is the suffix array of orig[0:size], in O(n) time, after Burkhardt and
+    Kärkkäinen (Fast lightweight suffix array construction and checking, CPM 2003): suffix is the
+    suffix array iff it is a permutation of [0, size), its first symbols are sorted, and the suffixes
+    with the same first symbol are ordered as the suffixes after them, i.e. ISA[SA[r] + 1] <
+    ISA[SA[r + 1] + 1] when orig[SA[r]] == orig[SA[r + 1]] (with ISA[size] = -1 for the empty
+    suffix).
+
+    The rank condition is checked without inverse suffix array, as an induction sweep: scanning the
+    suffix array from left to right after the empty suffix, the suffix before each scanned one, i - 1
+    with c = orig[i - 1], has to be the next unvisited entry of bucket c. If every bucket is visited
+    exactly up to its end, the entries are also a permutation (the visits give one entry per offset
+    from size - 1 down) in buckets of the right first symbol.
+
+    Memory: two counters per symbol (4 kB), next to orig and suffix. Time: one scan of suffix with a
+    random access to orig per entry, as one induction sweep of sais.
+*/
+template <class index_t>
+bool sais_check_implementation(const uint8_t * orig, const index_t * suffix, const int64_t size)
+{
+    if (size < 1)
+        return size == 0;
+    if (orig == NULL || suffix == NULL)
+        return false;
+
+    int64_t head[256]; // next entry of the bucket
+    int64_t tail[256]; // end of the bucket
+    for (int chr = 0; chr < 256; ++chr){ tail[chr] = 0; }
+    for (int64_t odx = 0; odx < size; ++odx){ ++tail[orig[odx]]; }
+    int64_t total = 0;
+    for (int chr = 0; chr < 256; ++chr)
+    {
+        head[chr] = total;
+        total += tail[chr];
+        tail[chr] = total;
+    }
+
+    // The empty suffix comes first: the suffix before it is size - 1
+    {
+        const uint8_t chr = orig[size - 1];
+        if (static_cast<int64_t>(suffix[head[chr]]) != size - 1)
+            return false;
+        ++head[chr];
+    }
+    const int64_t ahead = 32; // prefetch distance for orig
+    for (int64_t sdx = 0; sdx < size; ++sdx)
+    {
+        if (sdx + ahead < size)
+        {
+            const int64_t next = static_cast<int64_t>(suffix[sdx + ahead]);
+            if (next > 0 && next < size){ __builtin_prefetch(orig + next - 1); }
+        }
+        const int64_t odx = static_cast<int64_t>(suffix[sdx]);
+        if (odx < 0 || odx >= size)
+            return false;
+        if (odx == 0)
+            continue;
+        const uint8_t chr = orig[odx - 1];
+        const int64_t pos = head[chr]++;
+        if (pos >= tail[chr] || static_cast<int64_t>(suffix[pos]) != odx - 1)
+            return false;
+    }
+    for (int chr = 0; chr < 256; ++chr)
+        if (head[chr] != tail[chr])
+            return false;
+    return true;
+}
+
+
+bool sais_check(const uint8_t * orig, const int32_t * suffix, const int32_t size)
+{
+    return sais_check_implementation<int32_t>(orig, suffix, size);
+}
+
+
+bool sais_check(const uint8_t * orig, const int64_t * suffix, const int64_t size)
+{
+    return sais_check_implementation<int64_t>(orig, suffix, size);
+}
+
+
+bool sais_check(const uint8_t * orig, const int40_t * suffix, const int64_t size)
+{
+    return sais_check_implementation<int40_t>(orig, suffix, size);
+}
+
+
+/*
+    Checks the primary index and BWT of encode(orig, suffix, encoded, size) against a suffix array
+    which passed sais_check: one scan of suffix and encoded, without extra memory.
+*/
+template <class index_t>
+bool bwt_check_implementation(const uint8_t * orig, const index_t * suffix, const uint8_t * encoded, const int64_t pointer, const int64_t size)
+{
+    if (size < 1)
+        return size == 0;
+    if (orig == NULL || suffix == NULL || encoded == NULL || encoded[0] != orig[size - 1])
+        return false;
+    int64_t target = 1;
+    int64_t found  = -1;
+    for (int64_t sdx = 0; sdx < size; ++sdx)
+    {
+        const int64_t odx = static_cast<int64_t>(suffix[sdx]);
+        if (odx == 0)
+            found = sdx + 1;
+        else if (target == size || encoded[target++] != orig[odx - 1])
+            return false;
+    }
+    return found == pointer;
+}
+
+
+bool bwt_check(const uint8_t * orig, const int32_t * suffix, const uint8_t * encoded, const int32_t pointer, const int32_t size)
+{
+    return bwt_check_implementation<int32_t>(orig, suffix, encoded, pointer, size);
+}
+
+
+bool bwt_check(const uint8_t * orig, const int64_t * suffix, const uint8_t * encoded, const int64_t pointer, const int64_t size)
+{
+    return bwt_check_implementation<int64_t>(orig, suffix, encoded, pointer, size);
+}
+
+
+/*
+    Checks the primary index and BWT of encode or sais_bwt without suffix array, e.g. for an index
+    which keeps only the BWT: the LF walk of decode_lean from the row of the empty suffix has to
+    spell orig from the back and reach the row of pointer after exactly size steps, so that the LF
+    mapping is one cycle over all size + 1 rows. Memory: byte_rank_compact over encoded, i.e. about
+    512 * size / 2^step_bits + size / 32 bytes (size / 2 for step_bits = 10); time: size rank queries.
+*/
+template <class index_t>
+bool bwt_check_lean_implementation(const uint8_t * orig, const uint8_t * encoded, const index_t pointer, const index_t size, const int step_bits)
+{
+    if (size < 1)
+        return size == 0;
+    if (orig == NULL || encoded == NULL || pointer < 1 || pointer > size)
+        return false;
+
+    const byte_rank_compact rank(encoded, static_cast<size_t>(size), step_bits);
+    index_t head[256];
+    index_t total = 1; // Sentinel '$'
+    for (int sym = 0; sym < 256; ++sym)
+    {
+        head[sym] = total;
+        total += static_cast<index_t>(rank.count(static_cast<uint8_t>(sym)));
+    }
+
+    index_t idx = 0; // row of the empty suffix
+    for (index_t cnt = 0; cnt < size; ++cnt)
+    {
+        if (idx == pointer) // the cycle closes early
+            return false;
+        idx = idx < pointer ? idx : idx - 1; // Sentinel '$' not represented in encoded
+        const uint8_t sym = encoded[idx];
+        if (sym != orig[size - 1 - cnt])
+            return false;
+        idx = head[sym] + static_cast<index_t>(rank.rank(sym, static_cast<size_t>(idx)));
+    }
+    return idx == pointer;
+}
+
+
+bool bwt_check_lean(const uint8_t * orig, const uint8_t * encoded, const int32_t pointer, const int32_t size, const int step_bits)
+{
+    return bwt_check_lean_implementation<int32_t>(orig, encoded, pointer, size, step_bits);
+}
+
+
+bool bwt_check_lean(const uint8_t * orig, const uint8_t * encoded, const int64_t pointer, const int64_t size, const int step_bits)
+{
+    return bwt_check_lean_implementation<int64_t>(orig, encoded, pointer, size, step_bits);
+}
+
+
+} // End of namespace aiss4
@@ -0,0 +1,107 @@
+/*
+    aiss4: suffix array via induced sorting
+
+    Copyright (c) 2020, Sebastian Wouters
+    All rights reserved.
+
+    This file is part of aiss4, licensed under the BSD 3-Clause License.
+    A copy of the License can be found in the file LICENSE in the root
+    folder of this project.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace aiss4
+{
+
+
+#ifndef AISS4_NAME_WORDS
+#define AISS4_NAME_WORDS 1
+#endif
+
+const bool name_words = AISS4_NAME_WORDS != 0; // Step 6 compares LMS substrings with equal_tokens (0: token by token)
+
+
+/*
+    left[0:len] == right[0:len], compared as sizeof(token_t) * len bytes: 32 bytes per step with AVX2,
+    8 bytes per step otherwise, and the tail with one overlapping load of the same width. Valid for
+    the unsigned token types of sais_implementation (uint8_t up to uint64_t, and the packed uint40_t),
+    for which equal bytes means equal values.
+*/
+template <class token_t, class index_t>
+inline bool equal_tokens(const token_t * left, const token_t * right, const index_t len)
+{
+    const uint8_t * lft = reinterpret_cast<const uint8_t *>(left);
+    const uint8_t * rgt = reinterpret_cast<const uint8_t *>(right);
+    const size_t bytes  = sizeof(token_t) * static_cast<size_t>(len);
+
+    if (bytes >= 8)
+    {
+        size_t pos = 0;
+#if defined(__AVX2__)
+        if (bytes >= 32)
+        {
+            for (; pos + 32 <= bytes; pos += 32)
+            {
+                const __m256i lhs = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(lft + pos));
+                const __m256i rhs = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rgt + pos));
+                if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(lhs, rhs)) != -1)
+                    return false;
+            }
+            if (pos == bytes)
+                return true;
+            const __m256i lhs = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(lft + bytes - 32));
+            const __m256i rhs = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rgt + bytes - 32));
+            return _mm256_movemask_epi8(_mm256_cmpeq_epi8(lhs, rhs)) == -1;
+        }
+#endif
+        uint64_t lhs;
+        uint64_t rhs;
+        for (; pos + 8 <= bytes; pos += 8)
+        {
+            memcpy(&lhs, lft + pos, 8);
+            memcpy(&rhs, rgt + pos, 8);
+            if (lhs != rhs)
+                return false;
+        }
+        if (pos == bytes)
+            return true;
+        memcpy(&lhs, lft + bytes - 8, 8);
+        memcpy(&rhs, rgt + bytes - 8, 8);
+        return lhs == rhs;
+    }
+    if (bytes >= 4)
+    {
+        uint32_t lhs[2];
+        uint32_t rhs[2];
+        memcpy(lhs,     lft,             4);
+        memcpy(lhs + 1, lft + bytes - 4, 4);
+        memcpy(rhs,     rgt,             4);
+        memcpy(rhs + 1, rgt + bytes - 4, 4);
+        return lhs[0] == rhs[0] && lhs[1] == rhs[1];
+    }
+    for (size_t pos = 0; pos < bytes; ++pos)
+        if (lft[pos] != rgt[pos])
+            return false;
+    return true;
+}
+
+
+// orig[left:left + len] == orig[right:right + len]; overloaded for packed texts
+template <class token_t, class index_t>
+inline bool equal_text(const token_t * orig, const index_t left, const index_t right, const index_t len)
+{
+    return equal_tokens(orig + left, orig + right, len);
+}
+
+
+} // End of namespace aiss4
+
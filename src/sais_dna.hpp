@@ -0,0 +1,178 @@
+/*
+    aiss4: suffix array via induced sorting
+
+    Copyright (c) 2020, Sebastian Wouters
+    All rights reserved.
+
+    This file is part of aiss4, licensed under the BSD 3-Clause License.
+    A copy of the License can be found in the file LICENSE in the root
+    folder of this project.
+*/
+
+#pragma once
+
+#include "sais.hpp"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+namespace aiss4
+{
+
+
+/*
+    Nucleotide text packed in 64-bit words: 2 bits per symbol for ACGT (32 symbols per word) or
+    3 bits per symbol for ACGTN (21 symbols per word, the top bit unused). The codes follow the byte
+    order (A < C < G < N < T), so that the suffix array of the packed text equals the one of the bytes.
+*/
+template <int bits>
+class packed_dna
+{
+    public:
+
+        static const int     per_word = 64 / bits;
+        static const uint64_t mask    = (static_cast<uint64_t>(1) << bits) - 1;
+
+        packed_dna(const uint64_t * words) : words(words) {}
+
+        uint8_t operator[](const int64_t pos) const
+        {
+            return static_cast<uint8_t>((words[pos / per_word] >> (bits * (pos % per_word))) & mask);
+        }
+
+        // Symbols [pos, pos + 32) for bits == 2; reads the padding word after the last one
+        uint64_t window(const int64_t pos) const
+        {
+            const int64_t wdx   = pos >> 5;
+            const int     shift = static_cast<int>(pos & 31) << 1;
+            return shift == 0 ? words[wdx] : (words[wdx] >> shift) | (words[wdx + 1] << (64 - shift));
+        }
+
+        const uint64_t * words;
+
+};
+
+
+template <>
+struct fixed_alphabet<packed_dna<2>>
+{
+    static const int size = 4;
+};
+
+
+template <>
+struct fixed_alphabet<packed_dna<3>>
+{
+    static const int size = 5;
+};
+
+
+template <int bits>
+inline void prefetch_text(const packed_dna<bits> & orig, const int64_t pos)
+{
+    __builtin_prefetch(orig.words + pos / packed_dna<bits>::per_word);
+}
+
+
+// For bits == 2, 32 symbols per comparison
+template <int bits, class index_t>
+inline bool equal_text(const packed_dna<bits> & orig, const index_t left, const index_t right, const index_t len)
+{
+    index_t odx = 0;
+    if (bits == 2)
+    {
+        for (; odx + 32 <= len; odx += 32)
+            if (orig.window(left + odx) != orig.window(right + odx))
+                return false;
+        if (odx < len)
+        {
+            const uint64_t tail = (static_cast<uint64_t>(1) << (2 * (len - odx))) - 1;
+            return ((orig.window(left + odx) ^ orig.window(right + odx)) & tail) == 0;
+        }
+        return true;
+    }
+    for (; odx < len; ++odx)
+        if (orig[left + odx] != orig[right + odx])
+            return false;
+    return true;
+}
+
+
+// Words of a packed text of size symbols, including one padding word
+int64_t dna_words(const int64_t size, const int bits)
+{
+    const int64_t per_word = 64 / bits;
+    return (size + per_word - 1) / per_word + 1;
+}
+
+
+/*
+    Pack orig[0:size] into packed[0:dna_words(size, bits)]: ACGT for bits == 2, ACGNT for bits == 3.
+    Returns false if orig contains another symbol.
+*/
+bool pack_dna(const uint8_t * orig, const int64_t size, uint64_t * packed, const int bits)
+{
+    int8_t code[256];
+    for (int chr = 0; chr < 256; ++chr){ code[chr] = -1; }
+    code['A'] = 0;
+    code['C'] = 1;
+    code['G'] = 2;
+    if (bits == 2){ code['T'] = 3; }
+    else { code['N'] = 3; code['T'] = 4; }
+
+    const int64_t per_word  = 64 / bits;
+    const int64_t num_words = dna_words(size, bits);
+    for (int64_t wdx = 0; wdx < num_words; ++wdx){ packed[wdx] = 0; }
+    bool valid = true;
+    for (int64_t odx = 0; odx < size; ++odx)
+    {
+        const int8_t cde = code[orig[odx]];
+        valid = valid && cde >= 0;
+        packed[odx / per_word] |= static_cast<uint64_t>(cde < 0 ? 0 : cde) << (bits * (odx % per_word));
+    }
+    return valid;
+}
+
+
+/*
+    Suffix array of a packed nucleotide text of size symbols (bits = 2 or 3), identical to sais on
+    the unpacked bytes
+*/
+template <class index_t>
+void sais_dna_implementation(const uint64_t * packed, const int bits, index_t * suffix, const index_t size, const int num_threads)
+{
+    if (packed == NULL)
+        return;
+    if (bits == 2)
+        sais_implementation<uint8_t, index_t>(packed_dna<2>(packed), 4, suffix, size, NULL, NULL, num_threads, NULL);
+    else if (bits == 3)
+        sais_implementation<uint8_t, index_t>(packed_dna<3>(packed), 5, suffix, size, NULL, NULL, num_threads, NULL);
+}
+
+
+void sais_dna(const uint64_t * packed, const int bits, int32_t * suffix, const int32_t size, const int num_threads)
+{
+    sais_dna_implementation<int32_t>(packed, bits, suffix, size, num_threads);
+}
+
+
+void sais_dna(const uint64_t * packed, const int bits, int64_t * suffix, const int64_t size, const int num_threads)
+{
+    sais_dna_implementation<int64_t>(packed, bits, suffix, size, num_threads);
+}
+
+
+void sais_dna(const uint64_t * packed, const int bits, int32_t * suffix, const int32_t size)
+{
+    sais_dna_implementation<int32_t>(packed, bits, suffix, size, 1);
+}
+
+
+void sais_dna(const uint64_t * packed, const int bits, int64_t * suffix, const int64_t size)
+{
+    sais_dna_implementation<int64_t>(packed, bits, suffix, size, 1);
+}
+
+
+} // End of namespace aiss4
+
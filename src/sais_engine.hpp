@@ -0,0 +1,429 @@
+/*
+    aiss4: suffix array via induced sorting
+
+    Copyright (c) 2020, Sebastian Wouters
+    All rights reserved.
+
+    This file is part of aiss4, licensed under the BSD 3-Clause License.
+    A copy of the License can be found in the file LICENSE in the root
+    folder of this project.
+*/
+
+#pragma once
+
+#include "allocator.hpp"
+#include "sais_types.hpp"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+namespace aiss4
+{
+
+
+/*
+    Sort of the LMS substrings in Steps 1 to 4 of sais_implementation:
+        engine_induce:   two induction sweeps over the whole suffix array (SA-IS)
+        engine_twostage: string sort of the LMS positions only, in the spirit of the B* sort of
+                         DivSufSort (Itoh and Tanaka's two-stage sort), followed by the same naming,
+                         recursion and final induction; byte texts only
+        engine_auto:     one of both from the statistics of Step 0
+*/
+enum sais_engine
+{
+    engine_induce   = 0,
+    engine_twostage = 1,
+    engine_auto     = 2
+};
+
+
+const int twostage_insertion = 16;      // ranges of at most this many LMS substrings are sorted by insertion
+const int twostage_wide      = 65536;   // from this many LMS positions on, the first bucketing takes two bytes
+const int twostage_density   = 8;       // engine_auto: at most one LMS position per this many bytes
+const int twostage_large     = 1 << 22; // engine_auto: from this size on, low-entropy texts too
+
+
+// Suffix type bit of orig[pos:]
+inline uint64_t stype_at(const uint64_t * stype, const int64_t pos)
+{
+    return (stype[pos >> 6] >> (pos & 63)) & 1;
+}
+
+
+/*
+    Key of orig[pos:pos + 7]: the bytes big-endian in the upper 56 bits, and in the lowest byte the
+    number of them before '$' (7 inside the text), so that a suffix which ends in the chunk is
+    smaller than the suffixes it is a prefix of
+*/
+inline uint64_t lms_chunk(const uint8_t * orig, const int64_t str_size, const int64_t pos)
+{
+    if (pos + 8 <= str_size)
+    {
+        uint64_t word;
+        memcpy(&word, orig + pos, sizeof(uint64_t));
+        return (__builtin_bswap64(word) & ~static_cast<uint64_t>(0xFF)) | 7;
+    }
+    const int64_t len = str_size - pos < 7 ? (str_size - pos > 0 ? str_size - pos : 0) : 7;
+    uint64_t word = static_cast<uint64_t>(len);
+    for (int64_t idx = 0; idx < len; ++idx){ word |= static_cast<uint64_t>(orig[pos + idx]) << (56 - 8 * idx); }
+    return word;
+}
+
+
+// Offset of the first LMS position in orig[start + from:start + stop] (from > 0), or -1
+inline int64_t first_lms(const uint64_t * stype, const int64_t str_size, const int64_t start, const int64_t from, const int64_t stop)
+{
+    for (int64_t off = from; off < stop && start + off < str_size; ++off)
+        if (stype_at(stype, start + off) && !stype_at(stype, start + off - 1))
+            return off;
+    return -1;
+}
+
+
+/*
+    Order of the LMS substrings at first and second, which agree in their first depth bytes. Bytes
+    are compared 7 at a time: the order of the suffixes refines the order of the LMS substrings
+    (tokens, with an L-type before an S-type suffix with the same token). If the bytes agree up to
+    the end of the first substring at off, the types at off decide: S-type means that both
+    substrings end at off (equal bytes and type at off give equal types before off), L-type that
+    the second substring is longer and larger.
+*/
+inline int compare_lms(const uint8_t * orig, const uint64_t * stype, const int64_t str_size, const int64_t first, const int64_t second, int64_t depth)
+{
+    while (true)
+    {
+        const uint64_t key1 = lms_chunk(orig, str_size, first  + depth);
+        const uint64_t key2 = lms_chunk(orig, str_size, second + depth);
+        if (key1 != key2)
+            return key1 < key2 ? -1 : 1;
+        if ((key1 & 0xFF) < 7)
+            return 0;
+        const int64_t off = first_lms(stype, str_size, first, depth > 0 ? depth : 1, depth + 7);
+        if (off >= 0)
+        {
+            const uint64_t type1 = stype_at(stype, first + off);
+            const uint64_t type2 = stype_at(stype, second + off);
+            if (type1 != type2)
+                return type1 < type2 ? -1 : 1;
+            if (type1)
+                return 0;
+        }
+        depth += 7;
+    }
+}
+
+
+/*
+    Sorts the LMS substrings starting at lms[0:num_lms], which agree in their first depth_start
+    bytes, with a multikey quicksort (Bentley and Sedgewick) on the keys of lms_chunk, over an
+    explicit stack of (start, stop, depth) ranges. Equal LMS substrings end up next to each other,
+    in any order, as after Step 4 of sais_implementation.
+*/
+template <class index_t>
+void sort_lms_substrings(const uint8_t * orig, const uint64_t * stype, const index_t str_size, index_t * lms, const index_t num_lms, const int64_t depth_start)
+{
+    if (num_lms < 2)
+        return;
+    struct range { index_t start; index_t stop; int64_t depth; };
+    size_t capacity = 64;
+    size_t top      = 0;
+    range * stack   = sais_new<range>(capacity);
+    stack[top++] = { 0, num_lms, depth_start };
+    while (top > 0)
+    {
+        const range cur = stack[--top];
+        index_t start = cur.start;
+        index_t stop  = cur.stop;
+        int64_t depth = cur.depth;
+        while (stop - start > twostage_insertion)
+        {
+            // Pivot: median of three keys
+            const index_t mid = start + (stop - start) / 2;
+            const uint64_t key_a = lms_chunk(orig, str_size, lms[start] + depth);
+            const uint64_t key_b = lms_chunk(orig, str_size, lms[mid] + depth);
+            const uint64_t key_c = lms_chunk(orig, str_size, lms[stop - 1] + depth);
+            const uint64_t pivot = key_a < key_b ? (key_b < key_c ? key_b : (key_a < key_c ? key_c : key_a))
+                                                 : (key_a < key_c ? key_a : (key_b < key_c ? key_c : key_b));
+
+            // Three-way partition: [start, lt) smaller, [lt, gt) equal, [gt, stop) larger
+            index_t lt  = start;
+            index_t gt  = stop;
+            index_t idx = start;
+            while (idx < gt)
+            {
+                const uint64_t key = lms_chunk(orig, str_size, lms[idx] + depth);
+                if (key < pivot)
+                {
+                    const index_t tmp = lms[idx]; lms[idx++] = lms[lt]; lms[lt++] = tmp;
+                }
+                else if (key > pivot)
+                {
+                    const index_t tmp = lms[idx]; lms[idx] = lms[--gt]; lms[gt] = tmp;
+                }
+                else
+                {
+                    ++idx;
+                }
+            }
+
+            if (top + 2 > capacity)
+            {
+                range * grown = sais_new<range>(2 * capacity);
+                for (size_t pos = 0; pos < top; ++pos){ grown[pos] = stack[pos]; }
+                sais_delete(stack, capacity);
+                stack = grown;
+                capacity *= 2;
+            }
+            if (lt - start > 1){ stack[top++] = { start, lt, depth }; }
+            if (stop - gt > 1){ stack[top++] = { gt, stop, depth }; }
+
+            // The equal keys continue 7 bytes deeper, except '$' (one suffix) and the substrings which
+            // end in the chunk: at the first LMS offset of the pivot, the S-type ones are equal to it
+            start = lt;
+            stop  = (pivot & 0xFF) < 7 ? lt : gt;
+            const int64_t off = stop > start ? first_lms(stype, str_size, lms[start], depth > 0 ? depth : 1, depth + 7) : -1;
+            if (off >= 0)
+            {
+                index_t split = start;
+                for (index_t idx = start; idx < stop; ++idx)
+                {
+                    if (!stype_at(stype, lms[idx] + off))
+                    {
+                        const index_t tmp = lms[idx]; lms[idx] = lms[split]; lms[split++] = tmp;
+                    }
+                }
+                stop = split;
+            }
+            depth += 7;
+        }
+        for (index_t idx = start + 1; idx < stop; ++idx)
+        {
+            const index_t pos = lms[idx];
+            index_t jdx = idx;
+            while (jdx > start && compare_lms(orig, stype, str_size, pos, lms[jdx - 1], depth) < 0)
+            {
+                lms[jdx] = lms[jdx - 1];
+                --jdx;
+            }
+            lms[jdx] = pos;
+        }
+    }
+    sais_delete(stack, capacity);
+}
+
+
+/*
+    Key of orig[start + depth:start + depth + 3] for the LMS substring at start, as lms_chunk in 32
+    bits. If the substring ends in these bytes, the bytes after its end become 0xFF and the lowest
+    byte 0xFF: its key is then the same as for all equal LMS substrings, and larger than for the
+    longer substrings with the same bytes up to its end (L-type instead of S-type there).
+*/
+inline uint32_t lms_key(const uint8_t * orig, const uint64_t * stype, const int64_t str_size, const int64_t start, const int64_t depth)
+{
+    const int64_t pos = start + depth;
+    uint32_t word;
+    if (pos + 4 <= str_size)
+    {
+        memcpy(&word, orig + pos, sizeof(uint32_t));
+        word = (__builtin_bswap32(word) & ~static_cast<uint32_t>(0xFF)) | 3;
+    }
+    else
+    {
+        const int64_t len = str_size - pos < 3 ? (str_size - pos > 0 ? str_size - pos : 0) : 3;
+        word = static_cast<uint32_t>(len);
+        for (int64_t idx = 0; idx < len; ++idx){ word |= static_cast<uint32_t>(orig[pos + idx]) << (24 - 8 * idx); }
+    }
+    const int64_t off = first_lms(stype, str_size, start, depth > 0 ? depth : 1, depth + 3);
+    if (off >= 0)
+        word |= ~static_cast<uint32_t>(0) >> (8 * (off - depth + 1));
+    return word;
+}
+
+
+/*
+    Sorts lms[0:count] (LMS substrings which agree in their first depth bytes) by keys[0:count] of
+    lms_key at depth, with a three-way quicksort over both arrays, and the ranges of equal keys with
+    sort_lms_substrings from depth + 3 on, except for equal substrings which end in the key
+*/
+template <class index_t>
+void sort_lms_keyed(const uint8_t * orig, const uint64_t * stype, const index_t str_size, index_t * lms, index_t * keys, const index_t count, const int64_t depth)
+{
+    auto swap = [&](const index_t first, const index_t second)
+    {
+        const index_t pos = lms[first]; lms[first] = lms[second]; lms[second] = pos;
+        const index_t key = keys[first]; keys[first] = keys[second]; keys[second] = key;
+    };
+    auto resolve = [&](const index_t start, const index_t stop)
+    {
+        if (stop - start > 1 && (static_cast<uint32_t>(keys[start]) & 0xFF) == 3)
+            sort_lms_substrings<index_t>(orig, stype, str_size, lms + start, static_cast<index_t>(stop - start), depth + 3);
+    };
+
+    struct range { index_t start; index_t stop; };
+    size_t capacity = 64;
+    size_t top      = 0;
+    range * stack   = sais_new<range>(capacity);
+    stack[top++] = { 0, count };
+    while (top > 0)
+    {
+        const range cur = stack[--top];
+        const index_t start = cur.start;
+        const index_t stop  = cur.stop;
+        if (stop - start > twostage_insertion)
+        {
+            const uint32_t key_a = static_cast<uint32_t>(keys[start]);
+            const uint32_t key_b = static_cast<uint32_t>(keys[start + (stop - start) / 2]);
+            const uint32_t key_c = static_cast<uint32_t>(keys[stop - 1]);
+            const uint32_t pivot = key_a < key_b ? (key_b < key_c ? key_b : (key_a < key_c ? key_c : key_a))
+                                                 : (key_a < key_c ? key_a : (key_b < key_c ? key_c : key_b));
+            index_t lt  = start;
+            index_t gt  = stop;
+            index_t idx = start;
+            while (idx < gt)
+            {
+                const uint32_t key = static_cast<uint32_t>(keys[idx]);
+                if (key < pivot){ swap(idx++, lt++); }
+                else if (key > pivot){ swap(idx, --gt); }
+                else { ++idx; }
+            }
+            if (top + 2 > capacity)
+            {
+                range * grown = sais_new<range>(2 * capacity);
+                for (size_t pos = 0; pos < top; ++pos){ grown[pos] = stack[pos]; }
+                sais_delete(stack, capacity);
+                stack = grown;
+                capacity *= 2;
+            }
+            if (lt - start > 1){ stack[top++] = { start, lt }; }
+            if (stop - gt > 1){ stack[top++] = { gt, stop }; }
+            resolve(lt, gt);
+        }
+        else
+        {
+            for (index_t idx = start + 1; idx < stop; ++idx)
+            {
+                const index_t pos = lms[idx];
+                const index_t key = keys[idx];
+                index_t jdx = idx;
+                for (; jdx > start && static_cast<uint32_t>(keys[jdx - 1]) > static_cast<uint32_t>(key); --jdx)
+                {
+                    lms[jdx]  = lms[jdx - 1];
+                    keys[jdx] = keys[jdx - 1];
+                }
+                lms[jdx]  = pos;
+                keys[jdx] = key;
+            }
+            index_t run = start;
+            for (index_t idx = start + 1; idx <= stop; ++idx)
+                if (idx == stop || keys[idx] != keys[run])
+                {
+                    resolve(run, idx);
+                    run = idx;
+                }
+        }
+    }
+    sais_delete(stack, capacity);
+}
+
+
+/*
+    Steps 1 to 4 of engine_twostage: the LMS positions, in text order in suffix[num_lms:2 * num_lms]
+    (free as 2 * num_lms <= str_size), are bucketed by their first one or two bytes into
+    suffix[0:num_lms]. suffix[num_lms:2 * num_lms] then takes the keys of the next three bytes, read
+    once per LMS position, by which the buckets are sorted; only the ranges of equal keys read the
+    text again. The rest of suffix becomes zero. Returns false for other texts than bytes, which
+    take the induction sweeps.
+*/
+template <class text_t, class index_t>
+bool sort_lms_twostage(const text_t, const uint64_t *, const index_t, index_t *, const index_t)
+{
+    return false;
+}
+
+
+template <class index_t>
+bool sort_lms_twostage(const uint8_t * orig, const uint64_t * stype, const index_t str_size, index_t * suffix, const index_t num_lms)
+{
+    index_t * source = suffix + num_lms;
+    index_t lms = num_lms;
+    for_each_lms_reverse(stype, str_size, [&](const index_t odx){ source[--lms] = odx; });
+
+    // Buckets of the first one or two bytes (orig[str_size - 1] is L-type, so every LMS position has a next byte)
+    const int width = num_lms >= twostage_wide ? 2 : 1;
+    const size_t num_buckets = static_cast<size_t>(1) << (8 * width);
+    index_t * locs = sais_new<index_t>(num_buckets);
+    for (size_t bkt = 0; bkt < num_buckets; ++bkt){ locs[bkt] = 0; }
+    auto bucket = [&](const index_t odx){ return width == 2 ? (static_cast<size_t>(orig[odx]) << 8) | orig[odx + 1] : static_cast<size_t>(orig[odx]); };
+    for (lms = 0; lms < num_lms; ++lms){ ++locs[bucket(source[lms])]; }
+    {
+        index_t total = 0;
+        index_t tmp;
+        for (size_t bkt = 0; bkt < num_buckets; ++bkt)
+        {
+            tmp = locs[bkt];
+            locs[bkt] = total;
+            total += tmp;
+        }
+    }
+    for (lms = 0; lms < num_lms; ++lms){ suffix[locs[bucket(source[lms])]++] = source[lms]; }
+
+    // The keys need 32 bits: the 8-bit and 16-bit suffix arrays of the recursion sort with the text directly
+    const bool keyed = sizeof(index_t) >= sizeof(uint32_t);
+    index_t * keys = suffix + num_lms;
+    if (keyed)
+        for (lms = 0; lms < num_lms; ++lms){ keys[lms] = static_cast<index_t>(lms_key(orig, stype, str_size, suffix[lms], width)); }
+    index_t start = 0;
+    for (size_t bkt = 0; bkt < num_buckets; ++bkt)
+    {
+        if (keyed)
+            sort_lms_keyed<index_t>(orig, stype, str_size, suffix + start, keys + start, static_cast<index_t>(locs[bkt] - start), width);
+        else
+            sort_lms_substrings<index_t>(orig, stype, str_size, suffix + start, static_cast<index_t>(locs[bkt] - start), width);
+        start = locs[bkt];
+    }
+    sais_delete(locs, num_buckets);
+    for (index_t sdx = num_lms; sdx < str_size; ++sdx){ suffix[sdx] = 0; }
+    return true;
+}
+
+
+template <class index_t>
+bool sort_lms_twostage(uint8_t * orig, const uint64_t * stype, const index_t str_size, index_t * suffix, const index_t num_lms)
+{
+    return sort_lms_twostage<index_t>(static_cast<const uint8_t *>(orig), stype, str_size, suffix, num_lms);
+}
+
+
+/*
+    engine_auto after Step 0 (the crossovers of tools/bench.cpp): engine_twostage for texts with
+    less than one LMS position per 8 bytes, i.e. long runs, where the induction sweeps pass over all
+    suffixes for few LMS substrings, and for large texts with less than one bit per byte of order-0
+    entropy (bucket sizes of Step 0), where the deep LMS substrings fall apart in the string sort;
+    engine_induce otherwise, and for the wider tokens of the recursion
+*/
+template <class index_t>
+sais_engine choose_engine(const index_t * head, const index_t abc_size, const index_t str_size, const index_t num_lms)
+{
+    if (abc_size > 256)
+        return engine_induce;
+    if (static_cast<int64_t>(num_lms) * twostage_density < static_cast<int64_t>(str_size))
+        return engine_twostage;
+    if (static_cast<int64_t>(str_size) < twostage_large)
+        return engine_induce;
+    double bits = 0.0;
+    for (index_t chr = 0; chr < abc_size; ++chr)
+    {
+        const index_t count = (chr + 1 < abc_size ? head[chr + 1] : str_size) - head[chr];
+        if (count > 0)
+        {
+            const double freq = static_cast<double>(count) / static_cast<double>(str_size);
+            bits -= freq * log2(freq);
+        }
+    }
+    return bits < 1.0 ? engine_twostage : engine_induce;
+}
+
+
+} // End of namespace aiss4
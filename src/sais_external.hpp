@@ -0,0 +1,399 @@
+/*
+    aiss4: suffix array via induced sorting
+
+    Copyright (c) 2020, Sebastian Wouters
+    All rights reserved.
+
+    This file is part of aiss4, licensed under the BSD 3-Clause License.
+    A copy of the License can be found in the file LICENSE in the root
+    folder of this project.
+*/
+
+#pragma once
+
+#include "sais.hpp"
+#include "rank.hpp"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <fstream>
+
+namespace aiss4
+{
+
+
+const size_t external_bytes      = 12;      // memory per character of a block: see sais_external
+const size_t external_window     = 1 << 20; // largest number of elements in the window of a file_window or the buffer of a file_writer
+const size_t external_window_min = 1 << 12; // smallest number of elements, if the block arrays leave less memory
+
+
+/*
+    Elements of data_t in each of num_windows windows, which share the part of memory not used by the block arrays
+*/
+template <class data_t>
+size_t external_elements(const size_t memory, const size_t used, const size_t num_windows)
+{
+    const size_t elements = memory > used ? (memory - used) / (num_windows * sizeof(data_t)) : 0;
+    return elements < external_window_min ? external_window_min : (elements > external_window ? external_window : elements);
+}
+
+
+/*
+    Access to the elements of a binary file through a window of elements entries.
+    The window is reloaded (from idx forward or backward) when idx falls outside,
+    so sequential access in the direction of the window reads every element once.
+*/
+template <class data_t>
+class file_window
+{
+    public:
+
+        file_window(const std::string & file, const int64_t size, const bool forward, const size_t elements) : size(size), forward(forward), length(static_cast<int64_t>(elements)), lo(0), hi(0)
+        {
+            reader.open(file, std::ios::binary | std::ios::in);
+            window = new data_t[elements];
+        }
+
+        ~file_window()
+        {
+            reader.close();
+            delete [] window;
+        }
+
+        bool good() const { return reader.good(); }
+
+        data_t get(const int64_t idx)
+        {
+            if (idx < lo || idx >= hi)
+            {
+                lo = forward ? idx : (idx + 1 > length ? idx + 1 - length : 0);
+                hi = lo + length < size ? lo + length : size;
+                reader.seekg(lo * sizeof(data_t));
+                reader.read(reinterpret_cast<char *>(window), (hi - lo) * sizeof(data_t));
+            }
+            return window[idx - lo];
+        }
+
+    private:
+
+        std::ifstream reader;
+        const int64_t size;
+        const bool    forward;
+        const int64_t length;
+        int64_t       lo;
+        int64_t       hi;
+        data_t      * window;
+
+};
+
+
+/*
+    Buffered sequential writer of a binary file, with a buffer of elements entries
+*/
+template <class data_t>
+class file_writer
+{
+    public:
+
+        file_writer(const std::string & file, const size_t elements) : capacity(elements), fill(0)
+        {
+            writer.open(file, std::ios::binary | std::ios::out | std::ios::trunc);
+            buffer = new data_t[elements];
+        }
+
+        ~file_writer()
+        {
+            flush();
+            writer.close();
+            delete [] buffer;
+        }
+
+        bool good() const { return writer.good(); }
+
+        void push(const data_t value)
+        {
+            buffer[fill++] = value;
+            if (fill == capacity)
+                flush();
+        }
+
+    private:
+
+        void flush()
+        {
+            writer.write(reinterpret_cast<const char *>(buffer), fill * sizeof(data_t));
+            fill = 0;
+        }
+
+        std::ofstream writer;
+        const size_t  capacity;
+        size_t        fill;
+        data_t      * buffer;
+
+};
+
+
+/*
+    Z-function of ptrn: zvec[idx] = lcp(ptrn[idx:], ptrn) and zvec[0] = size
+*/
+void z_function(const uint8_t * ptrn, int64_t * zvec, const int64_t size)
+{
+    zvec[0] = size;
+    int64_t lo = 0;
+    int64_t hi = 0;
+    for (int64_t idx = 1; idx < size; ++idx)
+    {
+        int64_t len = idx < hi ? (zvec[idx - lo] < hi - idx ? zvec[idx - lo] : hi - idx) : 0;
+        if (idx + len >= hi)
+        {
+            while (idx + len < size && ptrn[idx + len] == ptrn[len]) { ++len; }
+            lo = idx;
+            hi = idx + len;
+        }
+        zvec[idx] = len;
+    }
+}
+
+
+/*
+    Suffix array of the file input (int64_t, same order as sais) written to the file output,
+    using about memory bytes of RAM and temporary files with prefix temp (about 2 * 8n + n / 4 bytes).
+
+    The text T = input is cut in blocks of size m = memory / external_bytes, which are handled from
+    right to left. Block X = T[start:stop] with tail T[stop:] and suffixes S_i = T[i:]:
+
+    1. gt[i] = S_i > S_stop for i >= start is obtained from the Z-function of the pattern
+       T[stop:stop + m]; if the pattern matches fully, gt of the previous block decides.
+    2. The suffixes starting in X, together with S_stop, are sorted with sais_implementation on
+       3 * X[i] + 2 * gt[i] + 1 followed by 3 * T[stop] + 2: a symbol 3 * c + 1 (gt = 0) or
+       3 * c + 3 (gt = 1) compares with 3 * T[stop] + 2 as S_i with S_stop.
+    3. The rank of each tail suffix among the block suffixes follows from backward search with the
+       BWT of the block (gap array), with gt deciding for S_stop.
+    4. The block suffix array and the tail suffix array (on disk) are merged into a new file.
+
+    Peak memory: about 11 bytes per block character in every step (2 + 1 + 8 for the text, pattern and
+    Z-function of step 1, 2 + 1 + 8 for the sort of step 2, 1 + 8 + 2 for the BWT, gap array and
+    ranks of step 3, 8 for the gap array of step 4). The rest of memory is split over the windows of
+    the files open in that step (external_elements), so that about memory bytes are used in total
+    for memory of about 1 MB or more. Time and I/O: O(n^2 / m).
+*/
+bool sais_external(const std::string & input, const std::string & output, const size_t memory, const std::string & temp)
+{
+    int64_t size = -1;
+    {
+        std::ifstream probe;
+        probe.open(input, std::ios::binary | std::ios::in | std::ios::ate);
+        if (probe.good())
+            size = probe.tellg();
+        probe.close();
+    }
+    if (size < 0)
+        return false;
+    if (size < 2)
+    {
+        file_writer<int64_t> writer(output, 1);
+        if (size == 1)
+            writer.push(0);
+        return writer.good();
+    }
+
+    int64_t block = static_cast<int64_t>(memory / external_bytes);
+    block = block < 1 ? 1 : (block > INT32_MAX ? INT32_MAX : block);
+
+    const std::string sa_file[2] = { temp + ".sa0", temp + ".sa1" };
+    const std::string gt_file[2] = { temp + ".gt0", temp + ".gt1" };
+    const std::string blk_file   =   temp + ".blk";
+    int cur = 0;
+
+    bool success = true;
+    int64_t ptrn_size = 0; // size of the previous block
+    for (int64_t stop = size; success && stop > 0; stop -= ptrn_size)
+    {
+        const int64_t start = stop > block ? stop - block : 0;
+        const int64_t len   = stop - start;
+        uint16_t * text = new uint16_t[len + 1];
+        int64_t    hole = 0;       // rank of the block suffix without preceding block character
+        int64_t    head[257] = { }; // head[chr + 1] = number of block characters equal to chr
+
+        // Step 1: gt[i] = S_i > S_stop for i in [start, size); block characters into text
+        {
+            std::ifstream reader;
+            reader.open(input, std::ios::binary | std::ios::in);
+            reader.seekg(start);
+            uint8_t * raw = reinterpret_cast<uint8_t *>(text + (len + 1) / 2); // upper half of text
+            reader.read(reinterpret_cast<char *>(raw), len);
+            for (int64_t idx = 0; idx < len; ++idx){ text[idx] = raw[idx]; }
+            success = success && reader.good();
+            reader.close();
+        }
+        {
+            const size_t used = 2 * static_cast<size_t>(len + 1) + (stop < size ? 9 * static_cast<size_t>(ptrn_size) : 0);
+            const size_t elements = external_elements<uint8_t>(memory, used, 3);
+            file_writer<uint8_t> writer(gt_file[cur], elements);
+            uint8_t bits = 0;
+            if (stop == size) // all suffixes are larger than the empty suffix
+            {
+                for (int64_t idx = 0; idx < len; ++idx)
+                {
+                    text[idx] = 3 * text[idx] + 3;
+                    bits |= 1 << (idx & 7);
+                    if ((idx & 7) == 7 || idx == len - 1){ writer.push(bits); bits = 0; }
+                }
+                text[len] = 0;
+            }
+            else
+            {
+                uint8_t * ptrn = new uint8_t[ptrn_size];
+                int64_t * zvec = new int64_t[ptrn_size];
+                {
+                    std::ifstream reader;
+                    reader.open(input, std::ios::binary | std::ios::in);
+                    reader.seekg(stop);
+                    reader.read(reinterpret_cast<char *>(ptrn), ptrn_size);
+                    success = success && reader.good();
+                    reader.close();
+                }
+                z_function(ptrn, zvec, ptrn_size);
+
+                file_window<uint8_t> orig(input, size, true, elements);
+                file_window<uint8_t> prev(gt_file[1 - cur], (size - stop + 7) >> 3, true, elements); // gt w.r.t. S_{stop + ptrn_size} from offset stop
+                int64_t lo = start; // Z-box: T[lo:hi] == ptrn[0:hi - lo]
+                int64_t hi = start;
+                for (int64_t odx = start; odx < size; ++odx)
+                {
+                    int64_t lcp = odx < hi ? zvec[odx - lo] : 0;
+                    if (odx >= hi || lcp >= hi - odx)
+                    {
+                        lcp = odx < hi ? hi - odx : 0;
+                        while (lcp < ptrn_size && odx + lcp < size && orig.get(odx + lcp) == ptrn[lcp]) { ++lcp; }
+                        lo = odx;
+                        hi = odx + lcp;
+                    }
+                    bool larger;
+                    if (lcp == ptrn_size) // T[odx:odx + lcp] == T[stop:stop + lcp]: S_{odx + lcp} vs. S_{stop + lcp}
+                    {
+                        const int64_t pdx = odx + lcp - stop;
+                        larger = odx + lcp < size && ((prev.get(pdx >> 3) >> (pdx & 7)) & 1);
+                    }
+                    else if (odx + lcp == size) // S_odx is a proper prefix of S_stop
+                    {
+                        larger = false;
+                    }
+                    else
+                    {
+                        larger = (odx + lcp < hi ? ptrn[odx + lcp - lo] : orig.get(odx + lcp)) > ptrn[lcp];
+                    }
+                    const int64_t bdx = odx - start;
+                    if (larger){ bits |= 1 << (bdx & 7); }
+                    if ((bdx & 7) == 7 || odx == size - 1){ writer.push(bits); bits = 0; }
+                    if (odx < stop)
+                        text[bdx] = 3 * text[bdx] + (larger ? 3 : 1);
+                }
+                success = success && orig.good() && prev.good();
+                text[len] = 3 * ptrn[0] + 2;
+
+                delete [] ptrn;
+                delete [] zvec;
+            }
+            success = success && writer.good();
+        }
+
+        // Step 2: Sort the block suffixes and S_stop; write the block suffix array; keep the BWT
+        uint8_t * bwt = new uint8_t[len + 1];
+        {
+            int64_t * suffix = new int64_t[len + 1];
+            sais_implementation<uint16_t, int64_t>(text, 769, suffix, len + 1, NULL, NULL, 1, NULL);
+            file_writer<int64_t> writer(blk_file, external_elements<int64_t>(memory, 11 * static_cast<size_t>(len + 1), 1));
+            for (int64_t sdx = 0; sdx <= len; ++sdx)
+            {
+                const int64_t odx = suffix[sdx];
+                if (odx == 0)
+                {
+                    hole = sdx;
+                    bwt[sdx] = 0;
+                }
+                else
+                {
+                    bwt[sdx] = static_cast<uint8_t>((text[odx - 1] - 1) / 3);
+                }
+                if (odx < len)
+                    writer.push(start + odx);
+            }
+            success = success && writer.good();
+            delete [] suffix;
+            for (int64_t idx = 0; idx < len; ++idx){ ++head[(text[idx] - 1) / 3 + 1]; }
+            for (int chr = 0; chr < 256; ++chr){ head[chr + 1] += head[chr]; }
+        }
+        delete [] text;
+
+        // Step 3: Gap array: gap[sdx] tail suffixes fall in between block suffixes sdx - 1 and sdx
+        int64_t * gap = new int64_t[len + 1];
+        for (int64_t sdx = 0; sdx <= len; ++sdx){ gap[sdx] = 0; }
+        if (stop < size)
+        {
+            byte_rank<uint32_t> ranks(bwt, static_cast<size_t>(len + 1), 9);
+            const size_t elements = external_elements<uint8_t>(memory, 11 * static_cast<size_t>(len + 1), 2);
+            file_window<uint8_t> orig(input, size, false, elements);
+            file_window<uint8_t> curr(gt_file[cur], (size - start + 7) >> 3, false, elements);
+            int64_t rank = 0; // number of block suffixes and S_stop smaller than S_{odx + 1}
+            for (int64_t odx = size - 1; odx >= stop; --odx)
+            {
+                const uint8_t chr = orig.get(odx);
+                const int64_t bdx = odx - start;
+                const int64_t larger = (curr.get(bdx >> 3) >> (bdx & 7)) & 1;
+                rank = head[chr] + ranks.rank(chr, static_cast<size_t>(rank)) - (chr == 0 && rank > hole ? 1 : 0) + larger;
+                ++gap[rank - larger];
+            }
+            success = success && orig.good() && curr.good();
+        }
+        delete [] bwt;
+
+        // Step 4: Merge the block suffix array with the tail suffix array
+        {
+            const size_t elements = external_elements<int64_t>(memory, 8 * static_cast<size_t>(len + 1), 3);
+            file_writer<int64_t> writer(sa_file[cur], elements);
+            file_window<int64_t> blk(blk_file, len, true, elements);
+            if (stop < size)
+            {
+                file_window<int64_t> tail(sa_file[1 - cur], size - stop, true, elements);
+                int64_t tdx = 0;
+                for (int64_t sdx = 0; sdx <= len; ++sdx)
+                {
+                    for (int64_t cnt = 0; cnt < gap[sdx]; ++cnt){ writer.push(tail.get(tdx++)); }
+                    if (sdx < len){ writer.push(blk.get(sdx)); }
+                }
+                success = success && tail.good();
+            }
+            else
+            {
+                for (int64_t sdx = 0; sdx < len; ++sdx){ writer.push(blk.get(sdx)); }
+            }
+            success = success && blk.good() && writer.good();
+        }
+        delete [] gap;
+
+        ptrn_size = len;
+        cur = 1 - cur;
+    }
+
+    remove(sa_file[cur].c_str());
+    remove(gt_file[0].c_str());
+    remove(gt_file[1].c_str());
+    remove(blk_file.c_str());
+    if (success)
+    {
+        remove(output.c_str());
+        success = rename(sa_file[1 - cur].c_str(), output.c_str()) == 0;
+    }
+    else
+    {
+        remove(sa_file[1 - cur].c_str());
+    }
+    return success;
+}
+
+
+} // End of namespace aiss4
+
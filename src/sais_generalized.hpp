@@ -0,0 +1,122 @@
+/*
+    aiss4: suffix array via induced sorting
+
+    Copyright (c) 2020, Sebastian Wouters
+    All rights reserved.
+
+    This file is part of aiss4, licensed under the BSD 3-Clause License.
+    A copy of the License can be found in the file LICENSE in the root
+    folder of this project.
+*/
+
+#pragma once
+
+#include "sais.hpp"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <limits>
+
+namespace aiss4
+{
+
+
+/*
+    Generalized suffix array of the documents orig[offsets[doc]:offsets[doc + 1]], doc < num_docs.
+
+    Every document is closed by its own sentinel: the text handed to sais_implementation is
+    doc_0 $_0 doc_1 $_1 ... with $_doc = doc and character chr = num_docs + chr. The sentinels are
+    the smallest characters and all differ, so no suffix comparison runs across a document end,
+    and equal suffixes of different documents are ordered by document. The sentinel suffixes are
+    the num_docs smallest suffixes and are dropped.
+
+    Output for the n = offsets[num_docs] suffixes: suffix[sdx] = offset in orig, docs[sdx] = document
+    and (if positions != NULL) positions[sdx] = offset within the document, in one pass over the
+    sorted suffixes with a rank over the sentinel positions. suffix must hold n + num_docs entries.
+*/
+template <class token_t, class index_t>
+void generalized_implementation(const uint8_t * orig, const index_t * offsets, const index_t num_docs, index_t * suffix, index_t * docs, index_t * positions)
+{
+    const index_t size = offsets[num_docs] + num_docs;
+
+    // Step 1: Text with one sentinel per document; sentinel positions as bits
+    token_t  * text = new token_t[size];
+    const size_t num_words = (static_cast<size_t>(size) >> 6) + 1;
+    uint64_t * ends = new uint64_t[num_words];
+    index_t  * rank = new index_t[num_words]; // number of sentinels before word wdx
+    for (size_t wdx = 0; wdx < num_words; ++wdx){ ends[wdx] = 0; }
+    {
+        index_t tdx = 0;
+        for (index_t doc = 0; doc < num_docs; ++doc)
+        {
+            for (index_t odx = offsets[doc]; odx < offsets[doc + 1]; ++odx)
+                text[tdx++] = static_cast<token_t>(num_docs + orig[odx]);
+            ends[static_cast<size_t>(tdx) >> 6] |= static_cast<uint64_t>(1) << (tdx & 63);
+            text[tdx++] = static_cast<token_t>(doc);
+        }
+        index_t total = 0;
+        for (size_t wdx = 0; wdx < num_words; ++wdx)
+        {
+            rank[wdx] = total;
+            total += __builtin_popcountll(ends[wdx]);
+        }
+    }
+
+    // Step 2: Sort
+    sais_implementation<token_t, index_t>(text, num_docs + 256, suffix, size, NULL, NULL, 1, NULL);
+    delete [] text;
+
+    // Step 3: Drop the sentinel suffixes; document = number of sentinels before the suffix
+    for (index_t sdx = num_docs; sdx < size; ++sdx)
+    {
+        const index_t tdx = suffix[sdx];
+        const size_t  wdx = static_cast<size_t>(tdx) >> 6;
+        const index_t doc = rank[wdx] + __builtin_popcountll(ends[wdx] & ((static_cast<uint64_t>(1) << (tdx & 63)) - 1));
+        const index_t odx = tdx - doc;
+        suffix[sdx - num_docs] = odx;
+        docs[sdx - num_docs] = doc;
+        if (positions)
+            positions[sdx - num_docs] = odx - offsets[doc];
+    }
+
+    delete [] ends;
+    delete [] rank;
+}
+
+
+template <class index_t>
+bool sais_generalized_implementation(const uint8_t * orig, const index_t * offsets, const index_t num_docs, index_t * suffix, index_t * docs, index_t * positions)
+{
+    if (num_docs < 0 || (num_docs > 0 && (orig == NULL || offsets == NULL || suffix == NULL || docs == NULL)))
+        return false;
+    if (num_docs == 0)
+        return true;
+    for (index_t doc = 0; doc < num_docs; ++doc)
+        if (offsets[doc + 1] < offsets[doc])
+            return false;
+    if (offsets[0] != 0 || offsets[num_docs] > std::numeric_limits<index_t>::max() - num_docs)
+        return false;
+
+    if (static_cast<uint64_t>(num_docs) + 256 <= UINT16_MAX + 1)
+        generalized_implementation<uint16_t, index_t>(orig, offsets, num_docs, suffix, docs, positions);
+    else if (static_cast<uint64_t>(num_docs) + 256 <= static_cast<uint64_t>(UINT32_MAX) + 1)
+        generalized_implementation<uint32_t, index_t>(orig, offsets, num_docs, suffix, docs, positions);
+    else
+        return false;
+    return true;
+}
+
+
+bool sais_generalized(const uint8_t * orig, const int64_t * offsets, const int64_t num_docs, int64_t * suffix, int64_t * docs, int64_t * positions)
+{
+    return sais_generalized_implementation<int64_t>(orig, offsets, num_docs, suffix, docs, positions);
+}
+
+
+bool sais_generalized(const uint8_t * orig, const int32_t * offsets, const int32_t num_docs, int32_t * suffix, int32_t * docs, int32_t * positions)
+{
+    return sais_generalized_implementation<int32_t>(orig, offsets, num_docs, suffix, docs, positions);
+}
+
+
+} // End of namespace aiss4
@@ -0,0 +1,431 @@
+/*
+    aiss4: suffix array via induced sorting
+
+    Copyright (c) 2020, Sebastian Wouters
+    All rights reserved.
+
+    This file is part of aiss4, licensed under the BSD 3-Clause License.
+    A copy of the License can be found in the file LICENSE in the root
+    folder of this project.
+*/
+
+#pragma once
+
+#include "allocator.hpp"
+#include "parallel.hpp"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+namespace aiss4
+{
+
+
+#ifndef AISS4_INDUCE_WINDOW
+#define AISS4_INDUCE_WINDOW 0
+#endif
+
+const size_t induce_block       = 1 << 16;             // entries per thread in a block of the threaded sweeps
+const size_t induce_window      = AISS4_INDUCE_WINDOW; // entries in a window of the serial read-ahead sweeps (0: off)
+const size_t induce_window_min  = 1 << 20;             // serial read-ahead only for levels which exceed the caches
+const int    induce_prefetch    = 32;                  // prefetch distance in the read phase
+const int    induce_share       = 1 << 10;             // threaded blocks have at least this many entries per thread
+const size_t induce_count_ratio = 16;                  // bucket counts per thread if abc_size * 16 <= entries per thread
+
+
+// Prefetch orig[pos]; overloaded for packed texts
+template <class token_t>
+inline void prefetch_text(const token_t * orig, const int64_t pos)
+{
+    __builtin_prefetch(orig + pos);
+}
+
+
+/*
+    Block-wise versions of the induction sweeps (Steps 2, 3, 10 and 11) of sais_implementation.
+
+    Each sweep walks suffix in blocks of entries whose inductions do not land in the block itself:
+    the L-part of bucket c is [head[c], split[c]) and the S-part [split[c], head[c + 1]), and the
+    slots which a sweep may still write are [locs[c], split[c]) resp. [split[c], locs[c]). A block
+    ends before the first such slot, so that every entry of the block is known when it starts.
+    Buckets which are full (or of which the remaining slots are behind the sweep) never become
+    writable again, hence the first writable bucket is found with a pointer which only moves on.
+
+    A block is handled in three phases by the threads of a pool, each on a contiguous range:
+      A. (parallel) the characters and type flags induced by the entries are fetched from orig,
+         with software prefetches induce_prefetch entries ahead, and counted per thread and bucket;
+      B. (serial)   the counts give every thread a disjoint range in each bucket, in sweep order;
+      C. (parallel) every thread writes its inductions into its ranges and updates its own entries.
+    With larger alphabets, Phase B assigns the slots entry by entry instead of clearing and summing
+    num_threads counters per bucket. The result is identical to the serial sweep. Short blocks, e.g.
+    in runs of a character which induce each other, are handled serially entry by entry.
+
+    With a single thread and small blocks (induce_window), Phase A gathers the scattered orig
+    accesses of a window ahead of its bucket writes, which hides part of the cache misses on texts
+    much larger than the last level cache. Whether this pays off depends on the memory system,
+    hence it is off by default: build with -DAISS4_INDUCE_WINDOW=4096 to enable it.
+
+    With primary != NULL, Steps 10 and 11 leave BWT characters instead of indices (see sais_bwt).
+*/
+template <class token_t, class index_t>
+class induce_buffer
+{
+    public:
+
+        induce_buffer(const int num_threads, const index_t str_size, const index_t abc_size, const size_t block_per_thread)
+            : pool(num_threads), threads(pool.size()), abc_size(abc_size)
+        {
+            const size_t block = static_cast<size_t>(threads) * block_per_thread;
+            size     = static_cast<size_t>(str_size) < block ? str_size : static_cast<index_t>(block);
+            min_size = static_cast<index_t>(threads > 1 ? threads * induce_share : 1);
+            counting = static_cast<size_t>(abc_size) * induce_count_ratio <= block_per_thread;
+            chrs  = sais_new<token_t>(static_cast<size_t>(size));
+            vals  = sais_new<index_t>(static_cast<size_t>(size));
+            slots = counting ? sais_new<index_t>(static_cast<size_t>(threads) * static_cast<size_t>(abc_size)) : sais_new<index_t>(static_cast<size_t>(size));
+            split = sais_new<index_t>(static_cast<size_t>(abc_size));
+        }
+
+        induce_buffer(const induce_buffer &) = delete;
+
+        induce_buffer & operator=(const induce_buffer &) = delete;
+
+        ~induce_buffer()
+        {
+            sais_delete(split, static_cast<size_t>(abc_size));
+            sais_delete(slots, counting ? static_cast<size_t>(threads) * static_cast<size_t>(abc_size) : static_cast<size_t>(size));
+            sais_delete(vals, static_cast<size_t>(size));
+            sais_delete(chrs, static_cast<size_t>(size));
+        }
+
+        // split[c] = end of the L-part of bucket c, from the S-type bitmap and the bucket heads of Step 0
+        template <class text_t>
+        void split_buckets(const text_t orig, const uint64_t * stype, const index_t str_size, const index_t * head)
+        {
+            for (index_t chr = 0; chr < abc_size; ++chr){ split[chr] = 0; }
+            const int64_t num_words = static_cast<int64_t>(str_size) / 64 + 1;
+            for (int64_t wdx = 0; wdx < num_words; ++wdx)
+            {
+                for (uint64_t word = stype[wdx]; word != 0; word &= word - 1)
+                    --split[orig[static_cast<index_t>(wdx * 64 + __builtin_ctzll(word))]];
+            }
+            for (index_t chr = 0; chr < abc_size; ++chr){ split[chr] += chr + 1 < abc_size ? static_cast<index_t>(head[chr + 1]) : str_size; }
+        }
+
+        thread_pool pool;
+        const int   threads;
+        index_t     abc_size;
+        index_t     size;     // entries in a block
+        index_t     min_size; // shorter blocks are handled serially
+        bool        counting; // Phase B from per-thread bucket counts (else slot per entry)
+        token_t   * chrs;     // induced bucket of the entries of a block
+        index_t   * vals;     // induced values of the entries of a block
+        index_t   * slots;    // per-thread bucket counts, then offsets; or the slot per entry
+        index_t   * split;
+
+};
+
+
+/*
+    Sweep of suffix from left to right (forward) or right to left with the step: step.read(val, chr,
+    ind) gives the bucket and induced value of an entry val > 0, step.commit(sdx, val, chr, ind, slot)
+    writes it and updates the entry, step.skip(sdx, val) updates an entry val <= 0.
+*/
+template <bool forward, class token_t, class index_t, class step_t>
+void induce_sweep(step_t & step, index_t * suffix, const index_t str_size, index_t * locs, induce_buffer<token_t, index_t> & buf)
+{
+    const index_t abc_size = buf.abc_size;
+    const index_t * split  = buf.split;
+    const int threads      = buf.threads;
+    index_t next = forward ? 0 : abc_size - 1; // first bucket of which slots may still be written
+    index_t done = 0;                          // number of entries swept
+    while (done < str_size)
+    {
+        index_t blk; // start of the block
+        index_t len; // block length
+        if (forward)
+        {
+            blk = done;
+            while (next < abc_size && (locs[next] >= split[next] || locs[next] <= blk)) { ++next; }
+            const index_t stop = next < abc_size ? static_cast<index_t>(locs[next]) : str_size;
+            len = stop - blk < buf.size ? static_cast<index_t>(stop - blk) : buf.size;
+        }
+        else
+        {
+            const index_t end = str_size - done;
+            while (next >= 0 && (locs[next] <= split[next] || locs[next] >= end)) { --next; }
+            const index_t start = next >= 0 ? static_cast<index_t>(locs[next]) : static_cast<index_t>(0);
+            len = end - start < buf.size ? static_cast<index_t>(end - start) : buf.size;
+            blk = end - len;
+        }
+        done += len;
+
+        if (len < buf.min_size) // serial
+        {
+            for (index_t bdx = 0; bdx < len; ++bdx)
+            {
+                const index_t sdx = forward ? static_cast<index_t>(blk + bdx) : static_cast<index_t>(blk + len - 1 - bdx);
+                const index_t val = suffix[sdx];
+                if (val > 0)
+                {
+                    token_t chr;
+                    index_t ind;
+                    step.read(val, chr, ind);
+                    step.commit(sdx, val, chr, ind, forward ? locs[chr]++ : --locs[chr]);
+                }
+                else
+                {
+                    step.skip(sdx, val);
+                }
+            }
+            continue;
+        }
+
+        const index_t * src = suffix + blk;
+        auto range = [len, threads](const int thr, index_t & start, index_t & stop)
+        {
+            start = static_cast<index_t>((static_cast<int64_t>(len) * thr) / threads);
+            stop  = static_cast<index_t>((static_cast<int64_t>(len) * (thr + 1)) / threads);
+        };
+
+        // Phase A: read and count
+        auto read = [&](const int thr)
+        {
+            index_t start, stop;
+            range(thr, start, stop);
+            index_t * count = buf.counting ? buf.slots + static_cast<size_t>(thr) * static_cast<size_t>(abc_size) : NULL;
+            for (index_t chr = 0; count != NULL && chr < abc_size; ++chr){ count[chr] = 0; }
+            index_t val;
+            for (index_t bdx = start; bdx < stop; ++bdx)
+            {
+                if (bdx + induce_prefetch < stop && (val = src[bdx + induce_prefetch]) > 0)
+                    step.prefetch(val);
+                if ((val = src[bdx]) > 0)
+                {
+                    step.read(val, buf.chrs[bdx], buf.vals[bdx]);
+                    if (count != NULL)
+                        ++count[buf.chrs[bdx]];
+                }
+            }
+        };
+        buf.pool.run(read);
+
+        // Phase B: disjoint slots of the threads, in sweep order
+        if (buf.counting)
+        {
+            for (index_t chr = 0; chr < abc_size; ++chr)
+            {
+                index_t loc = locs[chr];
+                for (int cnt = 0; cnt < threads; ++cnt)
+                {
+                    const int thr = forward ? cnt : threads - 1 - cnt;
+                    index_t & slot = buf.slots[static_cast<size_t>(thr) * static_cast<size_t>(abc_size) + static_cast<size_t>(chr)];
+                    const index_t num = slot;
+                    slot = loc;
+                    loc  = forward ? loc + num : loc - num;
+                }
+                locs[chr] = loc;
+            }
+        }
+        else
+        {
+            for (index_t cnt = 0; cnt < len; ++cnt)
+            {
+                const index_t bdx = forward ? cnt : static_cast<index_t>(len - 1 - cnt);
+                if (src[bdx] > 0)
+                    buf.slots[bdx] = forward ? locs[buf.chrs[bdx]]++ : --locs[buf.chrs[bdx]];
+            }
+        }
+
+        // Phase C: write the inductions and update the entries
+        auto commit = [&](const int thr)
+        {
+            index_t start, stop;
+            range(thr, start, stop);
+            index_t * offset = buf.counting ? buf.slots + static_cast<size_t>(thr) * static_cast<size_t>(abc_size) : NULL;
+            for (index_t cnt = start; cnt < stop; ++cnt)
+            {
+                const index_t bdx = forward ? cnt : static_cast<index_t>(start + stop - 1 - cnt);
+                const index_t val = src[bdx];
+                if (val > 0)
+                {
+                    const token_t chr = buf.chrs[bdx];
+                    index_t slot;
+                    if (offset != NULL)
+                        slot = forward ? offset[chr]++ : --offset[chr];
+                    else
+                        slot = buf.slots[bdx];
+                    step.commit(blk + bdx, val, chr, buf.vals[bdx], slot);
+                }
+                else
+                {
+                    step.skip(blk + bdx, val);
+                }
+            }
+        };
+        buf.pool.run(commit);
+    }
+}
+
+
+// Step 2: Place the prefix indices of L-type characters at bucket head, retain S-type only
+template <class token_t, class index_t, class text_t>
+struct induce_lms_L_step
+{
+    const text_t orig;
+    index_t    * suffix;
+
+    void prefetch(const index_t val) const { prefetch_text(orig, val - 1); }
+
+    void read(const index_t val, token_t & chr, index_t & ind) const
+    {
+        chr = orig[val];
+        ind = orig[val - 1] < chr ? ~static_cast<index_t>(val - 1) : static_cast<index_t>(val - 1); // Index preceding L-type character
+    }
+
+    void commit(const index_t sdx, const index_t, const token_t, const index_t ind, const index_t slot) const
+    {
+        suffix[slot] = ind;
+        suffix[sdx]  = 0; // Reset
+    }
+
+    void skip(const index_t sdx, const index_t val) const
+    {
+        if (val < 0) { suffix[sdx] = ~val; } // S-type becomes positive
+    }
+};
+
+
+template <class token_t, class index_t, class text_t>
+void induce_lms_L(const text_t orig, index_t * suffix, const index_t str_size, index_t * locs, induce_buffer<token_t, index_t> & buf)
+{
+    const index_t odx = str_size - 2;
+    const token_t act = orig[str_size - 1]; // orig[str_size - 1] is L-type before '$'
+    suffix[locs[act]++] = orig[odx] < act ? ~odx : odx;
+    induce_lms_L_step<token_t, index_t, text_t> step = { orig, suffix };
+    induce_sweep<true>(step, suffix, str_size, locs, buf);
+}
+
+
+// Step 3: Place the prefix indices of S-type characters at bucket tail, retain LMS only
+template <class token_t, class index_t, class text_t>
+struct induce_lms_S_step
+{
+    const text_t orig;
+    index_t    * suffix;
+
+    void prefetch(const index_t val) const { prefetch_text(orig, val - 1); }
+
+    void read(const index_t val, token_t & chr, index_t & ind) const
+    {
+        chr = orig[val];
+        ind = orig[val - 1] > chr ? ~val : static_cast<index_t>(val - 1); // LMS negative with start index; S-type positive
+    }
+
+    void commit(const index_t sdx, const index_t, const token_t, const index_t ind, const index_t slot) const
+    {
+        suffix[slot] = ind;
+        suffix[sdx]  = 0; // Reset
+    }
+
+    void skip(const index_t, const index_t) const {}
+};
+
+
+template <class token_t, class index_t, class text_t>
+void induce_lms_S(const text_t orig, index_t * suffix, const index_t str_size, index_t * locs, induce_buffer<token_t, index_t> & buf)
+{
+    induce_lms_S_step<token_t, index_t, text_t> step = { orig, suffix };
+    induce_sweep<false>(step, suffix, str_size, locs, buf);
+}
+
+
+// Step 10: Place the indices of L-type characters at bucket head
+template <class token_t, class index_t, class text_t>
+struct induce_final_L_step
+{
+    const text_t orig;
+    index_t    * suffix;
+    index_t    * primary;
+
+    void prefetch(const index_t val) const { prefetch_text(orig, val - 1); }
+
+    void read(const index_t val, token_t & chr, index_t & ind) const
+    {
+        chr = orig[val - 1];
+        ind = val > 1 && orig[val - 2] < chr ? ~static_cast<index_t>(val - 1) : static_cast<index_t>(val - 1); // L-type positive, but after later handling negative
+    }
+
+    void commit(const index_t sdx, const index_t val, const token_t chr, const index_t ind, const index_t slot) const
+    {
+        if (primary) // BWT character instead of the index, positive after Step 11
+        {
+            suffix[sdx] = ~static_cast<index_t>(chr);
+            if (val == 1){ *primary = slot; }
+        }
+        else
+        {
+            suffix[sdx] = ~val; // L-type becomes negative
+        }
+        suffix[slot] = ind;
+    }
+
+    void skip(const index_t sdx, const index_t val) const { suffix[sdx] = ~val; } // S-type positive
+};
+
+
+template <class token_t, class index_t, class text_t>
+void induce_final_L(const text_t orig, index_t * suffix, const index_t str_size, index_t * locs, induce_buffer<token_t, index_t> & buf, index_t * primary)
+{
+    const index_t odx = str_size - 1;
+    const token_t act = orig[odx]; // orig[str_size - 1] is L-type before '$'
+    suffix[locs[act]++] = odx > 0 && orig[odx - 1] < act ? ~odx : odx; // < 0 resp. > 0 means it induces S-type resp. L-type
+    induce_final_L_step<token_t, index_t, text_t> step = { orig, suffix, primary };
+    induce_sweep<true>(step, suffix, str_size, locs, buf);
+}
+
+
+// Step 11: Place the indices of S-type characters at bucket tail
+template <class token_t, class index_t, class text_t>
+struct induce_final_S_step
+{
+    const text_t orig;
+    index_t    * suffix;
+    index_t    * primary;
+
+    void prefetch(const index_t val) const { prefetch_text(orig, val - 1); }
+
+    void read(const index_t val, token_t & chr, index_t & ind) const
+    {
+        const index_t odx = val - 1;
+        chr = orig[odx];
+        const bool flg = odx == 0 || orig[odx - 1] > chr;
+        if (primary) // BWT character negative
+            ind = flg && odx > 0 ? ~static_cast<index_t>(orig[odx - 1]) : (flg ? ~odx : odx);
+        else // L-type negative, S-type positive
+            ind = flg ? ~odx : odx;
+    }
+
+    void commit(const index_t sdx, const index_t val, const token_t chr, const index_t ind, const index_t slot) const
+    {
+        if (primary) // BWT character instead of the index
+        {
+            suffix[sdx] = static_cast<index_t>(chr);
+            if (val == 1){ *primary = slot; }
+        }
+        suffix[slot] = ind;
+    }
+
+    void skip(const index_t sdx, const index_t val) const { suffix[sdx] = ~val; } // Make L-type positive
+};
+
+
+template <class token_t, class index_t, class text_t>
+void induce_final_S(const text_t orig, index_t * suffix, const index_t str_size, index_t * locs, induce_buffer<token_t, index_t> & buf, index_t * primary)
+{
+    induce_final_S_step<token_t, index_t, text_t> step = { orig, suffix, primary };
+    induce_sweep<false>(step, suffix, str_size, locs, buf);
+}
+
+
+} // End of namespace aiss4
+
@@ -0,0 +1,131 @@
+/*
+    aiss4: suffix array via induced sorting
+
+    Copyright (c) 2020, Sebastian Wouters
+    All rights reserved.
+
+    This file is part of aiss4, licensed under the BSD 3-Clause License.
+    A copy of the License can be found in the file LICENSE in the root
+    folder of this project.
+*/
+
+#pragma once
+
+#include "sais.hpp"
+
+#include <stdint.h>
+#include <stdlib.h>
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+namespace aiss4
+{
+
+
+/*
+    LCP array with the Phi method of Kärkkäinen, Manzini and Puglisi (CPM 2009):
+    lcp[sdx] = lcp(orig[suffix[sdx - 1]:], orig[suffix[sdx]:]) and lcp[0] = 0.
+
+    No inverse suffix array as in Kasai et al.: Phi is built in lcp in text order. Since
+    PLCP[odx + 1] >= PLCP[odx] - 1, the permuted LCP array is stored as the bit vector with ones at
+    PLCP[odx] + 2 * odx (2n bits, as in Sadakane's succinct PLCP) with the position of every 64th
+    one, so that the gather lcp[sdx] = PLCP[suffix[sdx]] has independent memory accesses, unlike a
+    pointer chase along the cycles of suffix. Extra memory: 3n / 8 bytes.
+*/
+template <class index_t>
+void lcp_phi(const uint8_t * orig, const index_t * suffix, index_t * lcp, const index_t size)
+{
+    if (size < 1 || orig == NULL || suffix == NULL || lcp == NULL)
+        return;
+
+    const size_t num_words = (2 * static_cast<size_t>(size) >> 6) + 1;
+    uint64_t * ones   = new uint64_t[num_words];
+    size_t   * sample = new size_t[(static_cast<size_t>(size) >> 6) + 1];
+    for (size_t wdx = 0; wdx < num_words; ++wdx){ ones[wdx] = 0; }
+
+    // Step 1: Phi[suffix[sdx]] = suffix[sdx - 1], and -1 for the smallest suffix
+    lcp[suffix[0]] = -1;
+    for (index_t sdx = 1; sdx < size; ++sdx)
+        lcp[suffix[sdx]] = suffix[sdx - 1];
+
+    // Step 2: PLCP[odx] = lcp(orig[odx:], orig[Phi[odx]:]), with PLCP[odx + 1] >= PLCP[odx] - 1
+    index_t len = 0;
+    for (index_t odx = 0; odx < size; ++odx)
+    {
+        const index_t prv = lcp[odx];
+        if (prv < 0)
+        {
+            len = 0;
+        }
+        else
+        {
+            const index_t lim = size - (odx > prv ? odx : prv);
+            while (len < lim && orig[odx + len] == orig[prv + len]) { ++len; }
+        }
+        const size_t bit = static_cast<size_t>(len) + 2 * static_cast<size_t>(odx);
+        ones[bit >> 6] |= static_cast<uint64_t>(1) << (bit & 63);
+        if ((odx & 63) == 0){ sample[odx >> 6] = bit; }
+        if (len > 0) { --len; }
+    }
+
+    // Step 3: lcp[sdx] = PLCP[suffix[sdx]] = select(suffix[sdx]) - 2 * suffix[sdx]
+    for (index_t sdx = 0; sdx < size; ++sdx)
+    {
+        const index_t odx = suffix[sdx];
+        const size_t  pos = sample[odx >> 6];
+        size_t   wdx  = pos >> 6;
+        uint64_t word = ones[wdx] & (~static_cast<uint64_t>(0) << (pos & 63)); // ones from the sample onwards
+        int      skip = static_cast<int>(odx & 63);                          // ones to skip after the sample
+        int      cnt;
+        while ((cnt = __builtin_popcountll(word)) <= skip)
+        {
+            skip -= cnt;
+            word  = ones[++wdx];
+        }
+#ifdef __BMI2__
+        word = _pdep_u64(static_cast<uint64_t>(1) << skip, word);
+#else
+        for (; skip > 0; --skip){ word &= word - 1; }
+#endif
+        const size_t bit = (wdx << 6) + static_cast<size_t>(__builtin_ctzll(word));
+        lcp[sdx] = static_cast<index_t>(bit - 2 * static_cast<size_t>(odx));
+    }
+
+    delete [] ones;
+    delete [] sample;
+}
+
+
+/*
+    Suffix array and LCP array: peak memory of both arrays next to orig
+*/
+void sais_lcp(const uint8_t * orig, int64_t * suffix, int64_t * lcp, const int64_t size)
+{
+    sais(orig, suffix, size);
+    lcp_phi<int64_t>(orig, suffix, lcp, size);
+}
+
+
+void sais_lcp(const uint8_t * orig, int32_t * suffix, int32_t * lcp, const int32_t size)
+{
+    sais(orig, suffix, size);
+    lcp_phi<int32_t>(orig, suffix, lcp, size);
+}
+
+
+void sais_lcp(const uint8_t * orig, int64_t * suffix, int64_t * lcp, const int64_t size, const int num_threads)
+{
+    sais(orig, suffix, size, num_threads);
+    lcp_phi<int64_t>(orig, suffix, lcp, size);
+}
+
+
+void sais_lcp(const uint8_t * orig, int32_t * suffix, int32_t * lcp, const int32_t size, const int num_threads)
+{
+    sais(orig, suffix, size, num_threads);
+    lcp_phi<int32_t>(orig, suffix, lcp, size);
+}
+
+
+} // End of namespace aiss4
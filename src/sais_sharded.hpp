@@ -0,0 +1,626 @@
+/*
+    aiss4: suffix array via induced sorting
+
+    Copyright (c) 2020, Sebastian Wouters
+    All rights reserved.
+
+    This file is part of aiss4, licensed under the BSD 3-Clause License.
+    A copy of the License can be found in the file LICENSE in the root
+    folder of this project.
+*/
+
+#pragma once
+
+#include "sais.hpp"
+#include "rank.hpp"
+#include "sais_external.hpp"
+
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+namespace aiss4
+{
+
+
+/*
+    Anonymous shared mapping, zero-initialised: forked workers read and write the same pages as the
+    parent
+*/
+class shared_memory
+{
+    public:
+
+        shared_memory(const size_t bytes) : bytes(bytes), memory(NULL)
+        {
+            void * ptr = bytes > 0 ? mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0) : MAP_FAILED;
+            if (ptr != MAP_FAILED)
+                memory = ptr;
+        }
+
+        shared_memory(const shared_memory &) = delete;
+
+        shared_memory & operator=(const shared_memory &) = delete;
+
+        ~shared_memory()
+        {
+            if (memory != NULL)
+                munmap(memory, bytes);
+        }
+
+        bool good() const { return memory != NULL; }
+
+        template <class data_t>
+        data_t * get() const { return static_cast<data_t *>(memory); }
+
+    private:
+
+        const size_t bytes;
+        void *       memory;
+
+};
+
+
+/*
+    Runs job.phase(phase, worker) for all phases and workers, phase after phase.
+
+    With processes, every worker is a forked process with a pipe pair to the parent, which acts as
+    barrier between the phases: the worker reports the outcome of a phase ('+' or '-') and waits
+    until the parent answers '+' (all workers succeeded: continue) or '-' (stop). Data is exchanged
+    through shared_memory of the job, which the workers inherit. Without processes, the workers run
+    one after the other in the calling process.
+
+    The workers leave with _exit, so job.phase must keep everything which other workers or the
+    parent need in shared memory. Fork from a process without other threads.
+
+    With phase_seconds, the largest CPU time of a worker in each phase, so that their sum is the
+    time with a core per worker, also when the workers share fewer cores.
+*/
+template <class job_t>
+bool run_shards(job_t & job, const int num_workers, const int num_phases, const bool processes, double * phase_seconds = NULL)
+{
+    auto cpu_seconds = [](){ timespec now; clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now); return now.tv_sec + 1e-9 * now.tv_nsec; };
+    for (int phase = 0; phase_seconds != NULL && phase < num_phases; ++phase){ phase_seconds[phase] = 0.0; }
+
+    if (!processes)
+    {
+        bool success = true;
+        for (int phase = 0; success && phase < num_phases; ++phase)
+        {
+            for (int worker = 0; success && worker < num_workers; ++worker)
+            {
+                const double start = cpu_seconds();
+                success = job.phase(phase, worker);
+                const double time = cpu_seconds() - start;
+                if (phase_seconds != NULL && time > phase_seconds[phase]){ phase_seconds[phase] = time; }
+            }
+        }
+        return success;
+    }
+
+    int   * up     = new int[num_workers]; // read end of the pipe worker -> parent
+    int   * down   = new int[num_workers]; // write end of the pipe parent -> worker
+    pid_t * pids   = new pid_t[num_workers];
+    int     forked = 0;
+    bool success   = true;
+    for (int worker = 0; success && worker < num_workers; ++worker)
+    {
+        int to_parent[2];
+        int to_worker[2];
+        if (pipe(to_parent) != 0)
+        {
+            success = false;
+            break;
+        }
+        if (pipe(to_worker) != 0)
+        {
+            close(to_parent[0]);
+            close(to_parent[1]);
+            success = false;
+            break;
+        }
+        const pid_t pid = fork();
+        if (pid == 0)
+        {
+            // Worker: only its own pipe ends, so that the parent sees EOF if it dies
+            for (int prev = 0; prev < forked; ++prev){ close(up[prev]); close(down[prev]); }
+            close(to_parent[0]);
+            close(to_worker[1]);
+            bool good = true;
+            for (int phase = 0; good && phase < num_phases; ++phase)
+            {
+                const double start = cpu_seconds();
+                try { good = job.phase(phase, worker); } catch (...) { good = false; }
+                char report[1 + sizeof(double)];
+                const double time = cpu_seconds() - start;
+                report[0] = good ? '+' : '-';
+                memcpy(report + 1, &time, sizeof(double));
+                good = write(to_parent[1], report, sizeof(report)) == sizeof(report) && good;
+                char answer = '-';
+                if (good && phase + 1 < num_phases)
+                    good = read(to_worker[0], &answer, 1) == 1 && answer == '+';
+            }
+            _exit(good ? 0 : 1);
+        }
+        close(to_parent[1]);
+        close(to_worker[0]);
+        if (pid < 0)
+        {
+            close(to_parent[0]);
+            close(to_worker[1]);
+            success = false;
+            break;
+        }
+        up[forked]   = to_parent[0];
+        down[forked] = to_worker[1];
+        pids[forked] = pid;
+        ++forked;
+    }
+
+    // Barriers: a worker which dies (EOF) or fails stops all of them. Only the workers which reported
+    // '+' wait for an answer; the others have left, and writing to their pipe would raise SIGPIPE,
+    // which is therefore blocked during the answers and discarded afterwards (EPIPE fails the write).
+    bool * waiting = new bool[num_workers];
+    for (int phase = 0; forked > 0 && phase < num_phases; ++phase)
+    {
+        for (int worker = 0; worker < forked; ++worker)
+        {
+            char report[1 + sizeof(double)] = { '-' };
+            waiting[worker] = read(up[worker], report, sizeof(report)) == sizeof(report) && report[0] == '+';
+            success = waiting[worker] && success;
+            double time = 0.0;
+            memcpy(&time, report + 1, sizeof(double));
+            if (phase_seconds != NULL && time > phase_seconds[phase]){ phase_seconds[phase] = time; }
+        }
+        if (phase + 1 < num_phases)
+        {
+            sigset_t pipe_signal;
+            sigset_t previous;
+            sigemptyset(&pipe_signal);
+            sigaddset(&pipe_signal, SIGPIPE);
+            pthread_sigmask(SIG_BLOCK, &pipe_signal, &previous);
+            const char answer = success ? '+' : '-';
+            for (int worker = 0; worker < forked; ++worker)
+            {
+                if (waiting[worker])
+                    success = write(down[worker], &answer, 1) == 1 && success;
+            }
+            sigset_t pending;
+            sigpending(&pending);
+            if (sigismember(&pending, SIGPIPE) == 1 && sigismember(&previous, SIGPIPE) == 0)
+            {
+                const timespec no_wait = { 0, 0 };
+                while (sigtimedwait(&pipe_signal, NULL, &no_wait) == SIGPIPE) {}
+            }
+            pthread_sigmask(SIG_SETMASK, &previous, NULL);
+        }
+        if (!success)
+            break;
+    }
+    delete [] waiting;
+    for (int worker = 0; worker < forked; ++worker)
+    {
+        close(up[worker]);
+        close(down[worker]);
+        int status = 0;
+        success = waitpid(pids[worker], &status, 0) == pids[worker] && WIFEXITED(status) && WEXITSTATUS(status) == 0 && success;
+    }
+
+    delete [] up;
+    delete [] down;
+    delete [] pids;
+    return success;
+}
+
+
+/*
+    Suffix array of T = orig[0:size] from k = num_shards shards X_s = T[bound[s]:bound[s + 1]] of
+    equal size (the last one takes the remainder, so that no shard is larger than the next one), in
+    the spirit of pSAscan. With S_i = T[i:], stop_s = bound[s + 1] and r_s(i) the number of suffixes
+    starting in X_s which are smaller than S_i, the work of shard s on the text of shard t >= s is
+    the piece (s, t). Worker s does (s, s), and (s, t) for t > s goes to worker s if s + t is odd
+    and to worker t otherwise, so that every worker gets about (k - 1) / 2 of them.
+
+    Phase 0: Pieces (s, t): compare S_i, i in X_t, with S_stop through the Z-function of the pattern
+             X_{s+1}: larger, or tie if the pattern matches fully, in which case S_{i + |X_{s+1}|} vs.
+             S_{stop_{s+1}} decides, i.e. shard s + 1.
+    Phase 1: Sort the suffixes starting in X_s with sais_implementation on 3 * X_s[i] + 2 * gt[i] + 1
+             followed by 3 * T[stop_s] + 2, as in sais_external: the comparisons with S_stop are the
+             context which makes the order of the shard suffixes exact. The shard suffix array and
+             BWT go to shared memory.
+    Phase 2: Pieces (s, t), t > s: the rank of S_{stop_t} among the shard suffixes by binary search,
+             then backward search of X_t with the BWT of X_s gives r_s(i) for i in X_t, which is
+             added to acc[i] and counted in the gap array of s.
+    Phase 3: The suffix of row q of shard s has global rank q + acc[i] (smaller suffixes of the
+             shards before s) + the number of suffixes after X_s with r_s <= q (of the shards after
+             s), which replaces acc[i].
+    Phase 4: Every worker scatters its shard into the shared suffix array.
+
+    Shared memory: 3 sizeof(index_t) + 1 bytes per character, plus 2 bits per character and shard
+    for the comparisons. Each worker: about 10 bytes per shard character for the sort, and 4 for the
+    rank structure of a BWT. Work: the sorts add up to one sais of the text (with 769 symbols), the
+    backward searches to n (k - 1) / 2 rank queries, i.e. n / 2 per worker, which bounds the speedup.
+*/
+template <class index_t>
+class shard_job
+{
+    public:
+
+        static const int num_phases = 5;
+
+        shard_job(const uint8_t * orig, const index_t size, const int num_shards)
+            : orig(orig), size(size), num_shards(num_shards), shard_size(size / num_shards), bound(new index_t[num_shards + 2]), region(new size_t[num_shards * num_shards]), num_words(0)
+        {
+            for (int shard = 0; shard < num_shards; ++shard){ bound[shard] = shard * shard_size; }
+            bound[num_shards]     = size;
+            bound[num_shards + 1] = size;
+            for (int shard = 0; shard + 1 < num_shards; ++shard)
+            {
+                for (int text = shard; text < num_shards; ++text)
+                {
+                    region[shard * num_shards + text] = num_words;
+                    num_words += static_cast<size_t>((bound[text + 1] - bound[text] + 63) >> 6);
+                }
+            }
+            bits       = new shared_memory(2 * num_words * sizeof(uint64_t) + sizeof(uint64_t));
+            sa_memory  = new shared_memory(static_cast<size_t>(size) * sizeof(index_t));
+            bwt_memory = new shared_memory(static_cast<size_t>(size) + num_shards);
+            gap_memory = new shared_memory((static_cast<size_t>(size) + num_shards) * sizeof(index_t));
+            acc_memory = new shared_memory(static_cast<size_t>(size) * sizeof(index_t));
+            meta       = new shared_memory(static_cast<size_t>(num_shards) * meta_size * sizeof(index_t));
+        }
+
+        shard_job(const shard_job &) = delete;
+
+        shard_job & operator=(const shard_job &) = delete;
+
+        ~shard_job()
+        {
+            delete bits;
+            delete sa_memory;
+            delete bwt_memory;
+            delete gap_memory;
+            delete acc_memory;
+            delete meta;
+            delete [] bound;
+            delete [] region;
+        }
+
+        bool good() const
+        {
+            return bits->good() && sa_memory->good() && bwt_memory->good() && gap_memory->good() && acc_memory->good() && meta->good();
+        }
+
+        // The suffix array, after run_shards
+        const index_t * result() const { return sa_memory->get<index_t>(); }
+
+        bool phase(const int phase, const int worker)
+        {
+            if (phase == 0){ compare(worker); }
+            if (phase == 1){ sort(worker); }
+            if (phase == 2){ scan(worker); }
+            if (phase == 3){ rank(worker); }
+            if (phase == 4){ scatter(worker); }
+            return true;
+        }
+
+    private:
+
+        static const int meta_size   = 259; // per shard: hole, row of S_stop, head[257]
+        static const int shard_lanes = 8;   // backward searches per piece, each from a binary search
+
+        int owner(const int shard, const int text) const
+        {
+            return shard == text || ((shard + text) & 1) ? shard : text;
+        }
+
+        int shard_of(const index_t odx) const
+        {
+            const index_t text = odx / shard_size;
+            return text < num_shards ? static_cast<int>(text) : num_shards - 1;
+        }
+
+        index_t * shard_meta(const int shard) const { return meta->get<index_t>() + static_cast<size_t>(shard) * meta_size; }
+
+        index_t * shard_gap(const int shard) const { return gap_memory->get<index_t>() + bound[shard] + shard; }
+
+        uint8_t * shard_bwt(const int shard) const { return bwt_memory->get<uint8_t>() + bound[shard] + shard; }
+
+        // Phase 0: larger and tie bits of S_odx vs. S_stop for the pieces of worker
+        void compare(const int worker)
+        {
+            uint64_t * larger = bits->get<uint64_t>();
+            uint64_t * tie    = bits->get<uint64_t>() + num_words;
+            for (int shard = 0; shard + 1 < num_shards; ++shard)
+            {
+                const index_t stop = bound[shard + 1];
+                const uint8_t * ptrn = orig + stop;
+                const index_t ptrn_size = bound[shard + 2] - stop;
+                int64_t * zvec = NULL;
+                for (int text = shard; text < num_shards; ++text)
+                {
+                    if (owner(shard, text) != worker)
+                        continue;
+                    if (zvec == NULL)
+                    {
+                        zvec = new int64_t[ptrn_size];
+                        z_function(ptrn, zvec, ptrn_size);
+                    }
+                    uint64_t * gt = larger + region[shard * num_shards + text];
+                    uint64_t * eq = tie    + region[shard * num_shards + text];
+                    const index_t start = bound[text];
+                    index_t lo = start; // Z-box: T[lo:hi] == ptrn[0:hi - lo]
+                    index_t hi = start;
+                    for (index_t odx = start; odx < bound[text + 1]; ++odx)
+                    {
+                        index_t lcp = odx < hi ? static_cast<index_t>(zvec[odx - lo]) : 0;
+                        if (odx >= hi || lcp >= hi - odx)
+                        {
+                            lcp = odx < hi ? hi - odx : 0;
+                            while (lcp < ptrn_size && odx + lcp < size && orig[odx + lcp] == ptrn[lcp]) { ++lcp; }
+                            lo = odx;
+                            hi = odx + lcp;
+                        }
+                        if (odx == stop)
+                            continue;
+                        bool is_gt = false;
+                        bool is_eq = false;
+                        if (lcp == ptrn_size) // T[odx:odx + lcp] == T[stop:stop + lcp]
+                        {
+                            if (odx + lcp == size){ is_gt = false; }      // S_odx is a proper prefix of S_stop
+                            else if (stop + lcp == size){ is_gt = true; } // S_stop is a proper prefix of S_odx
+                            else { is_eq = true; }                        // S_{odx + lcp} vs. S_{stop + lcp}: next shard
+                        }
+                        else if (odx + lcp == size) // S_odx is a proper prefix of S_stop
+                        {
+                            is_gt = false;
+                        }
+                        else
+                        {
+                            is_gt = orig[odx + lcp] > ptrn[lcp];
+                        }
+                        const index_t bdx = odx - start;
+                        if (is_gt){ gt[bdx >> 6] |= static_cast<uint64_t>(1) << (bdx & 63); }
+                        if (is_eq){ eq[bdx >> 6] |= static_cast<uint64_t>(1) << (bdx & 63); }
+                    }
+                }
+                delete [] zvec;
+            }
+        }
+
+        // S_odx > S_{bound[shard + 1]}, for odx >= bound[shard] and odx != bound[shard + 1], after Phase 0
+        bool greater(int shard, index_t odx) const
+        {
+            const uint64_t * larger = bits->get<uint64_t>();
+            const uint64_t * tie    = bits->get<uint64_t>() + num_words;
+            while (true)
+            {
+                const int     text = shard_of(odx);
+                const index_t bdx  = odx - bound[text];
+                const size_t  wdx  = region[shard * num_shards + text] + static_cast<size_t>(bdx >> 6);
+                if (((tie[wdx] >> (bdx & 63)) & 1) == 0)
+                    return ((larger[wdx] >> (bdx & 63)) & 1) != 0;
+                odx += bound[shard + 2] - bound[shard + 1];
+                ++shard;
+            }
+        }
+
+        // Phase 1: suffix array, BWT, hole, row of S_stop and head of the shard
+        void sort(const int shard)
+        {
+            const index_t start = bound[shard];
+            const index_t stop  = bound[shard + 1];
+            const index_t len   = stop - start;
+            uint16_t * text = new uint16_t[len + 1];
+            if (stop == size) // all suffixes are larger than the empty suffix
+            {
+                for (index_t idx = 0; idx < len; ++idx){ text[idx] = 3 * orig[start + idx] + 3; }
+                text[len] = 0;
+            }
+            else
+            {
+                for (index_t idx = 0; idx < len; ++idx){ text[idx] = 3 * orig[start + idx] + (greater(shard, start + idx) ? 3 : 1); }
+                text[len] = 3 * orig[stop] + 2;
+            }
+
+            index_t * suffix = new index_t[len + 1];
+            sais_implementation<uint16_t, index_t>(text, 769, suffix, len + 1, NULL, NULL, 1, NULL);
+            index_t * shard_sa = sa_memory->get<index_t>() + start;
+            uint8_t * bwt  = shard_bwt(shard);
+            index_t * info = shard_meta(shard);
+            index_t * head = info + 2; // head[chr + 1] = number of shard characters equal to chr
+            index_t   kept = 0;
+            for (index_t sdx = 0; sdx <= len; ++sdx)
+            {
+                const index_t odx = suffix[sdx];
+                if (odx == 0)
+                {
+                    info[0]  = sdx; // hole: the shard suffix without preceding shard character
+                    bwt[sdx] = 0;
+                }
+                else
+                {
+                    bwt[sdx] = static_cast<uint8_t>((text[odx - 1] - 1) / 3);
+                }
+                if (odx < len){ shard_sa[kept++] = start + odx; }
+                else { info[1] = sdx; }
+            }
+            for (index_t idx = 0; idx < len; ++idx){ ++head[orig[start + idx] + 1]; }
+            for (int chr = 0; chr < 256; ++chr){ head[chr + 1] += head[chr]; }
+            delete [] text;
+            delete [] suffix;
+        }
+
+        // Number of suffixes of shard and S_stop smaller than S_pos, for pos > stop: binary search with the lcp of both bounds
+        index_t start_rank(const int shard, const index_t pos) const
+        {
+            if (pos == size)
+                return 0;
+            const index_t   stop     = bound[shard + 1];
+            const index_t   stop_row = shard_meta(shard)[1];
+            const index_t * shard_sa = sa_memory->get<index_t>() + bound[shard];
+            index_t lo = 0;
+            index_t hi = stop - bound[shard] + 1;
+            index_t lcp_lo = 0; // lcp of S_pos with the row before lo
+            index_t lcp_hi = 0; // lcp of S_pos with row hi
+            while (lo < hi)
+            {
+                const index_t mid = lo + (hi - lo) / 2;
+                bool    smaller;
+                index_t lcp = 0;
+                if (mid == stop_row)
+                {
+                    smaller = greater(shard, pos);
+                }
+                else
+                {
+                    const index_t odx   = shard_sa[mid < stop_row ? mid : mid - 1];
+                    const index_t limit = stop - odx < size - pos ? stop - odx : size - pos;
+                    lcp = lcp_lo < lcp_hi ? lcp_lo : lcp_hi;
+                    lcp = lcp < limit ? lcp : limit;
+                    while (lcp < limit && orig[odx + lcp] == orig[pos + lcp]) { ++lcp; }
+                    if (lcp < limit){ smaller = orig[odx + lcp] < orig[pos + lcp]; }
+                    else if (pos + lcp == size){ smaller = false; }             // S_pos is a proper prefix of S_odx
+                    else { smaller = greater(shard, pos + lcp); }               // S_stop vs. S_{pos + lcp}
+                }
+                if (smaller){ lo = mid + 1; lcp_lo = lcp; } else { hi = mid; lcp_hi = lcp; }
+            }
+            return lo;
+        }
+
+        // Phase 2: backward search of the pieces of worker
+        void scan(const int worker)
+        {
+            index_t * acc = acc_memory->get<index_t>();
+            for (int shard = 0; shard + 1 < num_shards; ++shard)
+            {
+                const index_t   stop = bound[shard + 1];
+                const index_t * info = shard_meta(shard);
+                const index_t * head = info + 2;
+                const index_t   hole = info[0];
+                index_t * gap = shard_gap(shard);
+                byte_rank_compact * ranks = NULL;
+                for (int text = shard + 1; text < num_shards; ++text)
+                {
+                    if (owner(shard, text) != worker)
+                        continue;
+                    if (ranks == NULL)
+                        ranks = new byte_rank_compact(shard_bwt(shard), static_cast<size_t>(stop - bound[shard] + 1), 7);
+                    // Independent lanes in lockstep, to overlap the cache misses of their rank queries
+                    const index_t lane_size = (bound[text + 1] - bound[text] + shard_lanes - 1) / shard_lanes;
+                    index_t pos[shard_lanes];  // next offset of the lane: S_{pos + 1} has been ranked
+                    index_t end[shard_lanes];
+                    index_t rank[shard_lanes]; // number of shard suffixes and S_stop smaller than S_{pos + 1}
+                    for (int lane = 0; lane < shard_lanes; ++lane)
+                    {
+                        end[lane] = bound[text] + lane * lane_size;
+                        end[lane] = end[lane] < bound[text + 1] ? end[lane] : bound[text + 1];
+                        pos[lane] = end[lane] + lane_size < bound[text + 1] ? end[lane] + lane_size : bound[text + 1];
+                        rank[lane] = pos[lane] > end[lane] ? start_rank(shard, pos[lane]) : 0;
+                        --pos[lane];
+                    }
+                    for (index_t step = 0; step < lane_size; ++step)
+                    {
+                        for (int lane = 0; lane < shard_lanes; ++lane)
+                        {
+                            const index_t odx = pos[lane];
+                            if (odx < end[lane])
+                                continue;
+                            const uint8_t chr = orig[odx];
+                            const index_t larger = odx == stop ? 0 : (greater(shard, odx) ? 1 : 0);
+                            const index_t prev = rank[lane];
+                            rank[lane] = head[chr] + static_cast<index_t>(ranks->rank(chr, static_cast<size_t>(prev))) - (chr == 0 && prev > hole ? 1 : 0) + larger;
+                            __atomic_fetch_add(gap + rank[lane] - larger, 1, __ATOMIC_RELAXED);
+                            __atomic_fetch_add(acc + odx, rank[lane] - larger, __ATOMIC_RELAXED);
+                            pos[lane] = odx - 1;
+                            if (odx > end[lane])
+                                ranks->prefetch(orig[odx - 1], static_cast<size_t>(rank[lane]));
+                        }
+                    }
+                }
+                delete ranks;
+            }
+        }
+
+        // Phase 3: global rank of every suffix of the shard into acc
+        void rank(const int shard)
+        {
+            const index_t len = bound[shard + 1] - bound[shard];
+            const index_t * shard_sa = sa_memory->get<index_t>() + bound[shard];
+            index_t * gap = shard_gap(shard);
+            index_t * acc = acc_memory->get<index_t>();
+            for (index_t sdx = 1; sdx <= len; ++sdx){ gap[sdx] += gap[sdx - 1]; }
+            for (index_t sdx = 0; sdx < len; ++sdx)
+            {
+                const index_t odx = shard_sa[sdx];
+                acc[odx] += sdx + gap[sdx];
+            }
+        }
+
+        // Phase 4: suffix array
+        void scatter(const int shard)
+        {
+            const index_t * acc = acc_memory->get<index_t>();
+            index_t * suffix = sa_memory->get<index_t>();
+            for (index_t odx = bound[shard]; odx < bound[shard + 1]; ++odx){ suffix[acc[odx]] = odx; }
+        }
+
+        const uint8_t * orig;
+        const index_t   size;
+        const int       num_shards;
+        const index_t   shard_size;
+        index_t       * bound;
+        size_t        * region;     // first word of piece (s, t) in the bit vectors
+        size_t          num_words;
+        shared_memory * bits;       // larger bits of all pieces, then tie bits
+        shared_memory * sa_memory;  // shard suffix arrays, then the suffix array
+        shared_memory * bwt_memory; // BWT of shard s (with S_stop) from bound[s] + s
+        shared_memory * gap_memory; // gap array of shard s from bound[s] + s
+        shared_memory * acc_memory; // acc[i]: sum of r_s(i) over the shards s before the one of i, then the rank of S_i
+        shared_memory * meta;
+
+};
+
+
+/*
+    Same result as sais(orig, suffix, size), built by num_workers worker processes (one per shard)
+    which exchange their results through shared memory; num_workers = 1 runs in the calling process.
+    Returns false if the shared memory or a worker failed. With phase_seconds: see run_shards.
+*/
+template <class index_t>
+bool sais_sharded_implementation(const uint8_t * orig, index_t * suffix, const index_t size, const int num_workers, double * phase_seconds = NULL)
+{
+    if (orig == NULL || suffix == NULL || size < 1)
+        return size == 0;
+    if (size == 1)
+    {
+        suffix[0] = 0;
+        return true;
+    }
+    const int num_shards = num_workers < 1 ? 1 : (num_workers > size ? static_cast<int>(size) : num_workers);
+    shard_job<index_t> job(orig, size, num_shards);
+    if (!job.good() || !run_shards(job, num_shards, shard_job<index_t>::num_phases, num_shards > 1, phase_seconds))
+        return false;
+    memcpy(suffix, job.result(), sizeof(index_t) * static_cast<size_t>(size));
+    return true;
+}
+
+
+bool sais_sharded(const uint8_t * orig, int32_t * suffix, const int32_t size, const int num_workers)
+{
+    return sais_sharded_implementation<int32_t>(orig, suffix, size, num_workers);
+}
+
+
+bool sais_sharded(const uint8_t * orig, int64_t * suffix, const int64_t size, const int num_workers)
+{
+    return sais_sharded_implementation<int64_t>(orig, suffix, size, num_workers);
+}
+
+
+} // End of namespace aiss4
@@ -0,0 +1,161 @@
+/*
+    aiss4: suffix array via induced sorting
+
+    Copyright (c) 2020, Sebastian Wouters
+    All rights reserved.
+
+    This file is part of aiss4, licensed under the BSD 3-Clause License.
+    A copy of the License can be found in the file LICENSE in the root
+    folder of this project.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <chrono>
+#include <ostream>
+#include <vector>
+
+namespace aiss4
+{
+
+
+#ifndef AISS4_STATS
+#define AISS4_STATS 0
+#endif
+
+const bool sais_stats_enabled = AISS4_STATS != 0; // build with -DAISS4_STATS=1 to record sais_stats
+
+
+/*
+    One call of sais_implementation: the top level has depth 0, the reduced problem of Step 7 depth 1, ...
+    step_ms[7] includes the time spent in the deeper levels.
+*/
+struct sais_level
+{
+    int     depth;
+    int64_t str_size;
+    int64_t abc_size;
+    int64_t num_lms;
+    int64_t name;
+    int     data_bytes;  // Step 7: bytes per name of the reduced text (0: names unique, no recursion)
+    int     index_bytes; // Step 7: bytes per suffix of the reduced problem
+    bool    head_heap;   // bucket heads allocated on the heap, i.e. not in the caller's buffer or workspace
+    bool    locs_heap;   // bucket locations idem
+    double  step_ms[12];
+};
+
+
+/*
+    Levels of the sais calls on this thread while attached with sais_stats_attach, in the order in
+    which they started. Only recorded when built with -DAISS4_STATS=1.
+*/
+struct sais_stats
+{
+    std::vector<sais_level> levels;
+
+    void clear() { levels.clear(); }
+
+    void report(std::ostream & out) const
+    {
+        for (const sais_level & level : levels)
+        {
+            out << "depth " << level.depth << ": size = " << level.str_size << ", abc = " << level.abc_size
+                << ", lms = " << level.num_lms << ", names = " << level.name
+                << ", step 7 = (" << level.data_bytes << ", " << level.index_bytes << ") bytes"
+                << ", heap = (" << level.head_heap << ", " << level.locs_heap << "), steps [ms] =";
+            for (int step = 0; step < 12; ++step){ out << " " << level.step_ms[step]; }
+            out << std::endl;
+        }
+    }
+};
+
+
+thread_local sais_stats * sais_stats_current = NULL;
+thread_local int          sais_stats_depth   = 0;
+
+
+// Record the sais calls of this thread into stats (NULL to stop); returns the previous stats
+sais_stats * sais_stats_attach(sais_stats * stats)
+{
+    sais_stats * previous = sais_stats_current;
+    sais_stats_current = stats;
+    return previous;
+}
+
+
+/*
+    Level of one sais_implementation call; all members are no-ops unless sais_stats_enabled and
+    stats are attached to the calling thread
+*/
+class sais_stats_recorder
+{
+    public:
+
+        sais_stats_recorder(const int64_t str_size, const int64_t abc_size, const bool head_heap, const bool locs_heap) : level(-1)
+        {
+            if (!sais_stats_enabled || sais_stats_current == NULL)
+                return;
+            sais_level entry;
+            entry.depth       = sais_stats_depth++;
+            entry.str_size    = str_size;
+            entry.abc_size    = abc_size;
+            entry.num_lms     = 0;
+            entry.name        = 0;
+            entry.data_bytes  = 0;
+            entry.index_bytes = 0;
+            entry.head_heap   = head_heap;
+            entry.locs_heap   = locs_heap;
+            for (int step = 0; step < 12; ++step){ entry.step_ms[step] = 0; }
+            level = static_cast<int64_t>(sais_stats_current->levels.size());
+            sais_stats_current->levels.push_back(entry);
+            mark = std::chrono::steady_clock::now();
+        }
+
+        sais_stats_recorder(const sais_stats_recorder &) = delete;
+
+        sais_stats_recorder & operator=(const sais_stats_recorder &) = delete;
+
+        ~sais_stats_recorder()
+        {
+            if (sais_stats_enabled && level >= 0)
+                --sais_stats_depth;
+        }
+
+        // Time since the previous step ended
+        void step(const int num)
+        {
+            if (!sais_stats_enabled || level < 0)
+                return;
+            const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            sais_stats_current->levels[level].step_ms[num] = std::chrono::duration_cast<std::chrono::nanoseconds>(now - mark).count() * 1e-6;
+            mark = now;
+        }
+
+        void names(const int64_t num_lms, const int64_t name)
+        {
+            if (!sais_stats_enabled || level < 0)
+                return;
+            sais_stats_current->levels[level].num_lms = num_lms;
+            sais_stats_current->levels[level].name    = name;
+        }
+
+        void dispatch(const int data_bytes, const int index_bytes)
+        {
+            if (!sais_stats_enabled || level < 0)
+                return;
+            sais_stats_current->levels[level].data_bytes  = data_bytes;
+            sais_stats_current->levels[level].index_bytes = index_bytes;
+        }
+
+    private:
+
+        int64_t level;
+        std::chrono::steady_clock::time_point mark;
+
+};
+
+
+} // End of namespace aiss4
+
@@ -0,0 +1,184 @@
+/*
+    aiss4: suffix array via induced sorting
+
+    Copyright (c) 2020, Sebastian Wouters
+    All rights reserved.
+
+    This file is part of aiss4, licensed under the BSD 3-Clause License.
+    A copy of the License can be found in the file LICENSE in the root
+    folder of this project.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifndef AISS4_TYPES_SIMD
+#define AISS4_TYPES_SIMD 1 // 0: scalar comparisons in classify_types of bytes, also on x86-64 (test29.scalar)
+#endif
+
+#if AISS4_TYPES_SIMD && (defined(__AVX2__) || defined(__SSE2__))
+#include <immintrin.h>
+#endif
+
+namespace aiss4
+{
+
+
+/*
+    Suffix types of sais_implementation in one backward pass: bit odx of stype (word odx >> 6) is set
+    if orig[odx:] is S-type. orig[str_size - 1] is L-type (before '$'). stype holds
+    str_size / 64 + 1 words, i.e. str_size / 8 bytes. The LMS positions are the S-type positions
+    with an L-type predecessor, see lms_word.
+
+    In the same pass, count[chr] becomes the number of occurrences of chr (Step 0). For bytes, the
+    comparisons with the next character are vectorised (AVX2 or SSE2, unless AISS4_TYPES_SIMD is 0)
+    into 64-bit lt / gt masks, and the runs of equal characters take the type of the first different
+    character to their right; the histogram is spread over four banks to break the dependency chains
+    of repeated characters.
+*/
+
+// S-type bits of a word from its lt (orig[odx] < orig[odx + 1]) and gt masks; carry is the type of the next word's bit 0
+inline uint64_t resolve_types(const uint64_t lt, const uint64_t gt, const bool carry)
+{
+    uint64_t stype = lt;
+    uint64_t equal = ~(lt | gt);
+    while (equal)
+    {
+        const int hi = 63 - __builtin_clzll(equal); // Top of the highest run of equal characters
+        const uint64_t below = ~equal & ((static_cast<uint64_t>(1) << hi) - 1);
+        const int lo = below ? 64 - __builtin_clzll(below) : 0;
+        const uint64_t run = (hi == 63 ? ~static_cast<uint64_t>(0) : ((static_cast<uint64_t>(1) << (hi + 1)) - 1)) & ~((static_cast<uint64_t>(1) << lo) - 1);
+        const bool type = hi == 63 ? carry : ((stype >> (hi + 1)) & 1) != 0;
+        if (type){ stype |= run; }
+        equal &= ~run;
+    }
+    return stype;
+}
+
+
+template <class text_t, class index_t>
+void classify_types(const text_t orig, const index_t str_size, uint64_t * stype, index_t * count, const index_t abc_size)
+{
+    for (index_t chr = 0; chr < abc_size; ++chr){ count[chr] = 0; }
+    const int64_t num_words = static_cast<int64_t>(str_size) / 64 + 1;
+    for (int64_t wdx = 0; wdx < num_words; ++wdx){ stype[wdx] = 0; }
+
+    ++count[orig[str_size - 1]];
+    bool next = false; // orig[str_size - 1] is L-type
+    for (int64_t odx = static_cast<int64_t>(str_size) - 2; odx >= 0; --odx)
+    {
+        const auto cur = orig[odx];
+        const auto prv = orig[odx + 1];
+        next = cur < prv || (cur == prv && next);
+        if (next)
+            stype[odx >> 6] |= static_cast<uint64_t>(1) << (odx & 63);
+        ++count[cur];
+    }
+}
+
+
+template <class index_t>
+void classify_types(const uint8_t * orig, const index_t str_size, uint64_t * stype, index_t * count, const index_t abc_size)
+{
+    uint64_t banks[4][256];
+    for (int bank = 0; bank < 4; ++bank)
+        for (int chr = 0; chr < 256; ++chr){ banks[bank][chr] = 0; }
+
+    const int64_t size      = static_cast<int64_t>(str_size);
+    const int64_t num_words = size / 64 + 1;
+    bool carry = false; // Type of the first position of the next word: orig[str_size - 1] is L-type
+    for (int64_t wdx = num_words - 1; wdx >= 0; --wdx)
+    {
+        const int64_t base = wdx * 64;
+        uint64_t lt = 0;
+        uint64_t gt = 0;
+        if (base + 64 < size) // orig[base:base + 65] is available
+        {
+#if AISS4_TYPES_SIMD && defined(__AVX2__)
+            const __m256i flip = _mm256_set1_epi8(static_cast<char>(0x80));
+            for (int half = 0; half < 2; ++half)
+            {
+                const __m256i cur = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(orig + base + 32 * half)), flip);
+                const __m256i nxt = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(orig + base + 32 * half + 1)), flip);
+                lt |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(nxt, cur)))) << (32 * half);
+                gt |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(cur, nxt)))) << (32 * half);
+            }
+#elif AISS4_TYPES_SIMD && defined(__SSE2__)
+            const __m128i flip = _mm_set1_epi8(static_cast<char>(0x80));
+            for (int quarter = 0; quarter < 4; ++quarter)
+            {
+                const __m128i cur = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(orig + base + 16 * quarter)), flip);
+                const __m128i nxt = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(orig + base + 16 * quarter + 1)), flip);
+                lt |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(nxt, cur)))) << (16 * quarter);
+                gt |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(cur, nxt)))) << (16 * quarter);
+            }
+#else
+            for (int bit = 0; bit < 64; ++bit)
+            {
+                lt |= static_cast<uint64_t>(orig[base + bit] < orig[base + bit + 1]) << bit;
+                gt |= static_cast<uint64_t>(orig[base + bit] > orig[base + bit + 1]) << bit;
+            }
+#endif
+            const uint8_t * ptr = orig + base;
+            for (int bit = 0; bit < 64; bit += 4)
+            {
+                ++banks[0][ptr[bit]];
+                ++banks[1][ptr[bit + 1]];
+                ++banks[2][ptr[bit + 2]];
+                ++banks[3][ptr[bit + 3]];
+            }
+        }
+        else // Last word: orig[str_size - 1] and the positions beyond are L-type
+        {
+            for (int64_t odx = base; odx < base + 64; ++odx)
+            {
+                const int bit = static_cast<int>(odx - base);
+                if (odx + 1 < size)
+                {
+                    lt |= static_cast<uint64_t>(orig[odx] < orig[odx + 1]) << bit;
+                    gt |= static_cast<uint64_t>(orig[odx] > orig[odx + 1]) << bit;
+                }
+                else
+                    gt |= static_cast<uint64_t>(1) << bit;
+                if (odx < size)
+                    ++banks[0][orig[odx]];
+            }
+        }
+        stype[wdx] = resolve_types(lt, gt, carry);
+        carry = (stype[wdx] & 1) != 0;
+    }
+
+    for (int64_t chr = 0; chr < static_cast<int64_t>(abc_size); ++chr)
+        count[chr] = chr < 256 ? static_cast<index_t>(banks[0][chr] + banks[1][chr] + banks[2][chr] + banks[3][chr]) : static_cast<index_t>(0);
+}
+
+
+// LMS bits of word wdx: S-type with an L-type predecessor; orig[0] is never LMS
+inline uint64_t lms_word(const uint64_t * stype, const int64_t wdx)
+{
+    const uint64_t below = wdx > 0 ? stype[wdx - 1] >> 63 : static_cast<uint64_t>(1);
+    return stype[wdx] & ~((stype[wdx] << 1) | below);
+}
+
+
+// func(odx) for the LMS positions odx in decreasing order, as the backward scans of sais_implementation
+template <class index_t, class func_t>
+void for_each_lms_reverse(const uint64_t * stype, const index_t str_size, func_t func)
+{
+    for (int64_t wdx = static_cast<int64_t>(str_size) / 64; wdx >= 0; --wdx)
+    {
+        uint64_t lms = lms_word(stype, wdx);
+        while (lms)
+        {
+            const int bit = 63 - __builtin_clzll(lms);
+            func(static_cast<index_t>(wdx * 64 + bit));
+            lms ^= static_cast<uint64_t>(1) << bit;
+        }
+    }
+}
+
+
+} // End of namespace aiss4
+
@@ -13,14 +13,39 @@
 
 #include "bwt.hpp"
 #include "sais.hpp"
+#include "sais_external.hpp"
+#include "sais_lcp.hpp"
+#include "sais_batch.hpp"
+#include "sais_generalized.hpp"
+#include "fm_index.hpp"
+#include "compress.hpp"
+#include "sais_dna.hpp"
+#include "csa.hpp"
+#include "sais_append.hpp"
+#include "allocator.hpp"
+#include "sais_sharded.hpp"
+#include "sais_check.hpp"
+#include "sais_engine.hpp"
 
 #include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <chrono>
 #include <algorithm>
 #include <cassert>
+#include <random>
+#include <vector>
+#include <atomic>
+#include <thread>
+
+#ifdef AISS4_HAVE_BZIP2
+#include <bzlib.h>
+#endif
 
 
 namespace aiss4
@@ -30,7 +55,8 @@ namespace aiss4
 /*
     O(n^2 * log(n)), with n = str_size
 */
-void quicksort(const uint8_t * orig, int32_t * suffix, const int32_t str_size)
+template <class token_t>
+void quicksort(const token_t * orig, int32_t * suffix, const int32_t str_size)
 {
     for (int32_t idx = 0; idx < str_size; ++idx)
         suffix[idx] = idx;
@@ -40,8 +66,8 @@ void quicksort(const uint8_t * orig, int32_t * suffix, const int32_t str_size)
             const int32_t limit = str_size - std::max(left, right);
             for (int32_t cnt = 0; cnt < limit; ++cnt)
             {
-                uint8_t l = orig[left  + cnt];
-                uint8_t r = orig[right + cnt];
+                token_t l = orig[left  + cnt];
+                token_t r = orig[right + cnt];
                 if (l != r)
                     return l < r;
             }
@@ -50,6 +76,34 @@ void quicksort(const uint8_t * orig, int32_t * suffix, const int32_t str_size)
 }
 
 
+/*
+    Kasai et al. (CPM 2001), with an inverse suffix array: O(n)
+*/
+void kasai(const uint8_t * orig, const int32_t * suffix, int32_t * lcp, const int32_t str_size)
+{
+    int32_t * inverse = new int32_t[str_size];
+    for (int32_t sdx = 0; sdx < str_size; ++sdx)
+        inverse[suffix[sdx]] = sdx;
+
+    int32_t len = 0;
+    for (int32_t odx = 0; odx < str_size; ++odx)
+    {
+        const int32_t sdx = inverse[odx];
+        if (sdx == 0)
+        {
+            lcp[0] = len = 0;
+            continue;
+        }
+        const int32_t prv = suffix[sdx - 1];
+        while (odx + len < str_size && prv + len < str_size && orig[odx + len] == orig[prv + len]) { ++len; }
+        lcp[sdx] = len;
+        if (len > 0) { --len; }
+    }
+
+    delete [] inverse;
+}
+
+
 bool tester(const std::string name, const uint8_t * orig, const int32_t str_size, const bool run_qsort)
 {
     std::cout << "Test " << name << std::endl;
@@ -58,6 +112,12 @@ bool tester(const std::string name, const uint8_t * orig, const int32_t str_size
     uint8_t  * decoded = new uint8_t[str_size];
     int32_t  * SA1     = run_qsort ? new int32_t[str_size] : NULL;
     int32_t  * SA2     = new int32_t[str_size];
+    if (huge_pages_default > 0)
+    {
+        advise_huge_pages(encoded, static_cast<size_t>(str_size));
+        advise_huge_pages(decoded, static_cast<size_t>(str_size));
+        advise_huge_pages(SA2, sizeof(int32_t) * static_cast<size_t>(str_size));
+    }
 
     // Q-sort: own implementation
     int32_t pointer1;
@@ -87,6 +147,26 @@ bool tester(const std::string name, const uint8_t * orig, const int32_t str_size
             same = same && SA1[sdx] == SA2[sdx];
     }
 
+    // Linear-time check of the suffix array and the BWT
+    start = std::chrono::system_clock::now();
+    same = same && sais_check(orig, SA2, str_size) && bwt_check(orig, SA2, encoded, pointer2, str_size);
+    end = std::chrono::system_clock::now();
+    time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    std::cout << "Time [ms] check  (size = " << str_size << ") = " << time << std::endl;
+
+    // SA-IS: BWT without suffix array
+    uint8_t * direct = new uint8_t[str_size];
+    start = std::chrono::system_clock::now();
+    const int32_t pointer3 = sais_bwt(orig, direct, SA2, str_size);
+    end = std::chrono::system_clock::now();
+    time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    std::cout << "Time [ms] BWT    (size = " << str_size << ") = " << time << std::endl;
+
+    same = same && pointer2 == pointer3;
+    for (int32_t idx = 0; same && idx < str_size; ++idx)
+        same = same && encoded[idx] == direct[idx];
+    delete [] direct;
+
     // Decode
     start = std::chrono::system_clock::now();
     decode(pointer2, encoded, decoded, str_size);
@@ -107,5 +187,1149 @@ bool tester(const std::string name, const uint8_t * orig, const int32_t str_size
 }
 
 
-} // End of namespace aiss4
+bool tester_parallel(const std::string name, const uint8_t * orig, const int32_t str_size, const int num_threads)
+{
+    std::cout << "Test " << name << std::endl;
+
+    int32_t * SA1 = new int32_t[str_size];
+    int32_t * SA2 = new int32_t[str_size];
+
+    // SA-IS: serial
+    auto start = std::chrono::system_clock::now();
+    sais(orig, SA1, str_size);
+    auto end = std::chrono::system_clock::now();
+    double time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    std::cout << "Time [ms] SA-IS  (size = " << str_size << ", threads = 1) = " << time << std::endl;
+
+    // SA-IS: block-wise induction sweeps
+    start = std::chrono::system_clock::now();
+    sais(orig, SA2, str_size, num_threads);
+    end = std::chrono::system_clock::now();
+    time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    std::cout << "Time [ms] SA-IS  (size = " << str_size << ", threads = " << num_threads << ") = " << time << std::endl;
+
+    bool same = true;
+    for (int32_t sdx = 0; same && sdx < str_size; ++sdx)
+        same = same && SA1[sdx] == SA2[sdx];
+
+    // BWT without suffix array: block-wise induction sweeps
+    uint8_t * encoded = new uint8_t[str_size];
+    uint8_t * direct  = new uint8_t[str_size];
+    const int32_t pointer1 = encode(orig, SA1, encoded, str_size);
+    const int32_t pointer2 = sais_bwt(orig, direct, SA2, str_size, num_threads);
+    same = same && pointer1 == pointer2;
+    for (int32_t idx = 0; same && idx < str_size; ++idx)
+        same = same && encoded[idx] == direct[idx];
+
+    delete [] SA1;
+    delete [] SA2;
+    delete [] encoded;
+    delete [] direct;
+
+    std::cout << "Test " << name << (same ? " success!" : " fail!") << std::endl;
+    return same;
+}
+
+
+bool tester_external(const std::string name, const uint8_t * orig, const int32_t str_size, const size_t memory, const std::string temp)
+{
+    std::cout << "Test " << name << std::endl;
+
+    int32_t * SA1 = new int32_t[str_size];
+    int64_t * SA2 = new int64_t[str_size];
+
+    // SA-IS: in memory
+    auto start = std::chrono::system_clock::now();
+    sais(orig, SA1, str_size);
+    auto end = std::chrono::system_clock::now();
+    double time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    std::cout << "Time [ms] SA-IS    (size = " << str_size << ") = " << time << std::endl;
+
+    // SA: external memory
+    const std::string input  = temp + ".txt";
+    const std::string output = temp + ".sa";
+    std::ofstream writer;
+    writer.open(input, std::ios::binary | std::ios::out | std::ios::trunc);
+    writer.write(reinterpret_cast<const char *>(orig), str_size);
+    writer.close();
+
+    // In a child process, whose peak resident set size may grow by memory bytes and some slack
+    // for the binary and the stream buffers beyond its resident set size at the fork
+    start = std::chrono::system_clock::now();
+    int64_t result[2] = { 0, -1 }; // success, growth [kB]
+    int fds[2];
+    std::cout.flush();
+    const pid_t pid = pipe(fds) == 0 ? fork() : -1;
+    if (pid == 0)
+    {
+        close(fds[0]);
+        int64_t pages = 0;
+        int64_t resident = 0;
+        std::ifstream statm("/proc/self/statm");
+        statm >> pages >> resident;
+        statm.close();
+        result[0] = sais_external(input, output, memory, temp) ? 1 : 0;
+        struct rusage resources;
+        getrusage(RUSAGE_SELF, &resources);
+        result[1] = resources.ru_maxrss - resident * (sysconf(_SC_PAGESIZE) / 1024);
+        const bool sent = write(fds[1], result, sizeof(result)) == sizeof(result);
+        close(fds[1]);
+        _exit(sent ? 0 : 1);
+    }
+    if (pid > 0)
+    {
+        close(fds[1]);
+        if (read(fds[0], result, sizeof(result)) != sizeof(result)){ result[0] = 0; }
+        close(fds[0]);
+        waitpid(pid, NULL, 0);
+    }
+    end = std::chrono::system_clock::now();
+    time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    std::cout << "Time [ms] external (size = " << str_size << ", memory = " << memory << ") = " << time << std::endl;
+    const int64_t budget = static_cast<int64_t>(memory / 1024) + static_cast<int64_t>(memory / 4096) + 2048;
+    std::cout << "Peak RSS growth [kB] = " << result[1] << " (memory + 25% + 2 MB = " << budget << ")" << std::endl;
+    bool same = result[0] == 1 && result[1] >= 0 && result[1] <= budget;
+
+    std::ifstream reader;
+    reader.open(output, std::ios::binary | std::ios::in);
+    reader.read(reinterpret_cast<char *>(SA2), static_cast<std::streamsize>(str_size) * sizeof(int64_t));
+    same = same && reader.good();
+    reader.close();
+    remove(input.c_str());
+    remove(output.c_str());
+
+    for (int32_t sdx = 0; same && sdx < str_size; ++sdx)
+        same = same && SA1[sdx] == SA2[sdx];
+
+    delete [] SA1;
+    delete [] SA2;
+
+    std::cout << "Test " << name << (same ? " success!" : " fail!") << std::endl;
+    return same;
+}
+
+
+bool tester_lcp(const std::string name, const uint8_t * orig, const int32_t str_size)
+{
+    std::cout << "Test " << name << std::endl;
+
+    int32_t * SA1  = new int32_t[str_size];
+    int32_t * SA2  = new int32_t[str_size];
+    int32_t * LCP1 = new int32_t[str_size];
+    int32_t * LCP2 = new int32_t[str_size];
+
+    // SA-IS + Kasai
+    auto start = std::chrono::system_clock::now();
+    sais(orig, SA1, str_size);
+    auto end = std::chrono::system_clock::now();
+    double time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    std::cout << "Time [ms] SA-IS  (size = " << str_size << ") = " << time << std::endl;
+    start = std::chrono::system_clock::now();
+    kasai(orig, SA1, LCP1, str_size);
+    end = std::chrono::system_clock::now();
+    time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    std::cout << "Time [ms] Kasai  (size = " << str_size << ") = " << time << std::endl;
+
+    // SA-IS + Phi
+    start = std::chrono::system_clock::now();
+    sais(orig, SA2, str_size);
+    end = std::chrono::system_clock::now();
+    const double time_sais = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    lcp_phi<int32_t>(orig, SA2, LCP2, str_size);
+    end = std::chrono::system_clock::now();
+    time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    std::cout << "Time [ms] Phi    (size = " << str_size << ") = " << time - time_sais << std::endl;
+
+    bool same = true;
+    for (int32_t sdx = 0; same && sdx < str_size; ++sdx)
+        same = same && SA1[sdx] == SA2[sdx] && LCP1[sdx] == LCP2[sdx];
+
+    delete [] SA1;
+    delete [] SA2;
+    delete [] LCP1;
+    delete [] LCP2;
+
+    std::cout << "Test " << name << (same ? " success!" : " fail!") << std::endl;
+    return same;
+}
+
+
+template <class token_t>
+bool tester_integer(const std::string name, const token_t * orig, const int32_t abc_size, const int32_t str_size, sais_workspace<int32_t> & workspace)
+{
+    std::cout << "Test " << name << std::endl;
+
+    int32_t * SA1 = new int32_t[str_size];
+    int32_t * SA2 = new int32_t[str_size];
+
+    // Q-sort: own implementation
+    auto start = std::chrono::system_clock::now();
+    quicksort(orig, SA1, str_size);
+    auto end = std::chrono::system_clock::now();
+    double time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    std::cout << "Time [ms] Q-sort (size = " << str_size << ", alphabet = " << abc_size << ") = " << time << std::endl;
+
+    // SA-IS: integer alphabet
+    start = std::chrono::system_clock::now();
+    sais<token_t, int32_t>(orig, abc_size, SA2, str_size, workspace);
+    end = std::chrono::system_clock::now();
+    time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    std::cout << "Time [ms] SA-IS  (size = " << str_size << ", alphabet = " << abc_size << ") = " << time << std::endl;
+
+    bool same = true;
+    for (int32_t sdx = 0; same && sdx < str_size; ++sdx)
+        same = same && SA1[sdx] == SA2[sdx];
+
+    delete [] SA1;
+    delete [] SA2;
+
+    std::cout << "Test " << name << (same ? " success!" : " fail!") << std::endl;
+    return same;
+}
+
+
+bool tester_batch(const std::string name, const uint8_t * orig, const int64_t * offsets, const int64_t num_records, const int num_threads)
+{
+    std::cout << "Test " << name << std::endl;
+
+    const int64_t str_size = offsets[num_records];
+    int32_t * SA1 = new int32_t[str_size];
+    int32_t * SA2 = new int32_t[str_size];
+
+    // SA-IS: one call per record
+    auto start = std::chrono::system_clock::now();
+    for (int64_t rec = 0; rec < num_records; ++rec)
+        sais(orig + offsets[rec], SA1 + offsets[rec], static_cast<int32_t>(offsets[rec + 1] - offsets[rec]));
+    auto end = std::chrono::system_clock::now();
+    double time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-9;
+    std::cout << "Records/s SA-IS loop  (records = " << num_records << ") = " << num_records / time << std::endl;
+
+    bool same = true;
+    const int threads[2] = { 1, num_threads };
+    for (const int thr : threads)
+    {
+        start = std::chrono::system_clock::now();
+        same = sais_batch(orig, offsets, num_records, SA2, thr) && same;
+        end = std::chrono::system_clock::now();
+        time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-9;
+        std::cout << "Records/s SA-IS batch (records = " << num_records << ", threads = " << thr << ") = " << num_records / time << std::endl;
+
+        for (int64_t sdx = 0; same && sdx < str_size; ++sdx)
+            same = same && SA1[sdx] == SA2[sdx];
+    }
+
+    delete [] SA1;
+    delete [] SA2;
+
+    std::cout << "Test " << name << (same ? " success!" : " fail!") << std::endl;
+    return same;
+}
+
+
+bool tester_generalized(const std::string name, const uint8_t * orig, const int32_t * offsets, const int32_t num_docs)
+{
+    std::cout << "Test " << name << std::endl;
+
+    const int32_t str_size = offsets[num_docs];
+    int32_t * SA1  = new int32_t[str_size];
+    int32_t * DA1  = new int32_t[str_size];
+    int32_t * SA2  = new int32_t[str_size + num_docs];
+    int32_t * DA2  = new int32_t[str_size];
+    int32_t * POS2 = new int32_t[str_size];
+
+    // Q-sort with document ends: a suffix ends at its document end, ties by document
+    auto start = std::chrono::system_clock::now();
+    for (int32_t doc = 0; doc < num_docs; ++doc)
+        for (int32_t odx = offsets[doc]; odx < offsets[doc + 1]; ++odx)
+        {
+            SA1[odx] = odx;
+            DA1[odx] = doc;
+        }
+    std::sort(SA1, SA1 + str_size, [orig, offsets, DA1](int32_t left, int32_t right)
+        {
+            const int32_t l_end = offsets[DA1[left]  + 1];
+            const int32_t r_end = offsets[DA1[right] + 1];
+            for (int32_t cnt = 0; left + cnt < l_end && right + cnt < r_end; ++cnt)
+                if (orig[left + cnt] != orig[right + cnt])
+                    return orig[left + cnt] < orig[right + cnt];
+            if (l_end - left != r_end - right)
+                return l_end - left < r_end - right;
+            return DA1[left] < DA1[right];
+        });
+    for (int32_t sdx = 0; sdx < str_size; ++sdx) // binary search over the document offsets
+        DA1[sdx] = static_cast<int32_t>(std::upper_bound(offsets, offsets + num_docs + 1, SA1[sdx]) - offsets) - 1;
+    auto end = std::chrono::system_clock::now();
+    double time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    std::cout << "Time [ms] Q-sort (size = " << str_size << ", documents = " << num_docs << ") = " << time << std::endl;
+
+    // SA-IS: generalized
+    start = std::chrono::system_clock::now();
+    bool same = sais_generalized(orig, offsets, num_docs, SA2, DA2, POS2);
+    end = std::chrono::system_clock::now();
+    time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    std::cout << "Time [ms] SA-IS  (size = " << str_size << ", documents = " << num_docs << ") = " << time << std::endl;
+
+    for (int32_t sdx = 0; same && sdx < str_size; ++sdx)
+        same = same && SA1[sdx] == SA2[sdx] && DA1[sdx] == DA2[sdx] && POS2[sdx] == SA2[sdx] - offsets[DA2[sdx]];
+
+    delete [] SA1;
+    delete [] DA1;
+    delete [] SA2;
+    delete [] DA2;
+    delete [] POS2;
+
+    std::cout << "Test " << name << (same ? " success!" : " fail!") << std::endl;
+    return same;
+}
+
+
+bool tester_int40(const std::string name, const uint8_t * orig, const int32_t str_size)
+{
+    std::cout << "Test " << name << std::endl;
+
+    int32_t * SA1 = new int32_t[str_size];
+    int40_t * SA2 = new int40_t[str_size];
+
+    // SA-IS: int32_t
+    auto start = std::chrono::system_clock::now();
+    sais(orig, SA1, str_size);
+    auto end = std::chrono::system_clock::now();
+    double time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    std::cout << "Time [ms] SA-IS  (size = " << str_size << ", int32_t) = " << time << std::endl;
+
+    // SA-IS: packed 40-bit
+    start = std::chrono::system_clock::now();
+    sais(orig, SA2, static_cast<int64_t>(str_size));
+    end = std::chrono::system_clock::now();
+    time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    std::cout << "Time [ms] SA-IS  (size = " << str_size << ", int40_t) = " << time << std::endl;
+
+    bool same = true;
+    for (int32_t sdx = 0; same && sdx < str_size; ++sdx)
+        same = same && static_cast<int64_t>(SA1[sdx]) == static_cast<int64_t>(SA2[sdx]);
+
+    // Texts beyond int40_max are refused before the suffix array is touched
+    bool limit = false;
+    try { sais(orig, SA2, int40_max + 1); }
+    catch (const std::length_error &) { limit = true; }
+    std::cout << "Size > int40_max refused = " << (limit ? "yes" : "no") << std::endl;
+    same = same && limit;
+
+    delete [] SA1;
+    delete [] SA2;
+
+    std::cout << "Test " << name << (same ? " success!" : " fail!") << std::endl;
+    return same;
+}
+
+
+bool tester_decode(const std::string name, const uint8_t * orig, const int32_t str_size, const int32_t num_samples, const int num_threads)
+{
+    std::cout << "Test " << name << std::endl;
+
+    int32_t * SA      = new int32_t[str_size];
+    int32_t * samples = new int32_t[2 * num_samples];
+    uint8_t * encoded = new uint8_t[str_size];
+    uint8_t * decoded = new uint8_t[str_size];
+    sais(orig, SA, str_size);
+    const int32_t pointer = encode(orig, SA, encoded, str_size, samples, num_samples);
+    delete [] SA;
+
+    // Decode: one LF chain
+    auto start = std::chrono::system_clock::now();
+    decode(pointer, encoded, decoded, str_size);
+    auto end = std::chrono::system_clock::now();
+    double time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    std::cout << "Time [ms] decode (size = " << str_size << ") = " << time << std::endl;
+
+    bool same = true;
+    for (int32_t odx = 0; same && odx < str_size; ++odx)
+        same = same && decoded[odx] == orig[odx];
+
+    // Decode: LF chains from the restart points
+    for (int threads = 1; threads <= num_threads; threads *= 2)
+    {
+        for (int32_t odx = 0; odx < str_size; ++odx){ decoded[odx] = 0; }
+        start = std::chrono::system_clock::now();
+        decode_parallel(pointer, encoded, decoded, str_size, samples, num_samples, threads);
+        end = std::chrono::system_clock::now();
+        time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+        std::cout << "Time [ms] decode (size = " << str_size << ", samples = " << num_samples << ", threads = " << threads << ") = " << time << std::endl;
+
+        for (int32_t odx = 0; same && odx < str_size; ++odx)
+            same = same && decoded[odx] == orig[odx];
+    }
+
+    // Decode: int64_t map
+    for (int32_t odx = 0; odx < str_size; ++odx){ decoded[odx] = 0; }
+    start = std::chrono::system_clock::now();
+    decode(static_cast<int64_t>(pointer), encoded, decoded, static_cast<int64_t>(str_size));
+    end = std::chrono::system_clock::now();
+    time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    std::cout << "Time [ms] decode (size = " << str_size << ", int64_t) = " << time << std::endl;
+
+    for (int32_t odx = 0; same && odx < str_size; ++odx)
+        same = same && decoded[odx] == orig[odx];
+
+    // Decode: rank checkpoints instead of map
+    for (int step_bits = 8; step_bits <= 12; step_bits += 2)
+    {
+        for (int32_t odx = 0; odx < str_size; ++odx){ decoded[odx] = 0; }
+        start = std::chrono::system_clock::now();
+        decode_lean(static_cast<int64_t>(pointer), encoded, decoded, static_cast<int64_t>(str_size), step_bits);
+        end = std::chrono::system_clock::now();
+        time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+        std::cout << "Time [ms] decode (size = " << str_size << ", lean, step bits = " << step_bits << ") = " << time << std::endl;
+
+        for (int32_t odx = 0; same && odx < str_size; ++odx)
+            same = same && decoded[odx] == orig[odx];
+    }
+
+    delete [] samples;
+    delete [] encoded;
+    delete [] decoded;
+
+    std::cout << "Test " << name << (same ? " success!" : " fail!") << std::endl;
+    return same;
+}
+
+
+/*
+    Check count, locate and extract of fm_index against the suffix array for patterns taken from
+    orig, and report the queries per second for each pattern length.
+*/
+bool tester_fm_index(const std::string name, const uint8_t * orig, const int32_t str_size, const int32_t sample_rate)
+{
+    std::cout << "Test " << name << std::endl;
+
+    int32_t * SA = new int32_t[str_size];
+    sais(orig, SA, str_size);
+
+    auto start = std::chrono::system_clock::now();
+    fm_index<int32_t> index(orig, str_size, sample_rate, 1);
+    auto end = std::chrono::system_clock::now();
+    double time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    std::cout << "Time [ms] FM-index (size = " << str_size << ", sample rate = " << sample_rate << ") = " << time << std::endl;
+
+    std::mt19937 generator(42);
+    const int32_t num_queries = 100000;
+    const int32_t num_located = 100;
+    int32_t * offsets = new int32_t[num_queries];
+    int32_t * hits    = new int32_t[str_size];
+    uint8_t * text    = new uint8_t[64];
+    bool same = true;
+
+    for (int32_t length = 4; length <= 64 && length <= str_size; length *= 2)
+    {
+        for (int32_t qdx = 0; qdx < num_queries; ++qdx)
+            offsets[qdx] = static_cast<int32_t>(generator() % static_cast<uint32_t>(str_size - length + 1));
+
+        // Count
+        int64_t total = 0;
+        start = std::chrono::system_clock::now();
+        for (int32_t qdx = 0; qdx < num_queries; ++qdx)
+            total += index.count(orig + offsets[qdx], length);
+        end = std::chrono::system_clock::now();
+        time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-9;
+        std::cout << "Count  (length = " << length << ") = " << num_queries / time << " queries/s, " << total << " hits" << std::endl;
+
+        // Locate
+        int64_t located = 0;
+        start = std::chrono::system_clock::now();
+        for (int32_t qdx = 0; qdx < num_located; ++qdx)
+            located += index.locate(orig + offsets[qdx], length, hits, str_size);
+        end = std::chrono::system_clock::now();
+        time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-9;
+        std::cout << "Locate (length = " << length << ") = " << num_located / time << " queries/s, " << located / time << " hits/s" << std::endl;
+
+        // Compare with binary search in SA for the located patterns
+        for (int32_t qdx = 0; same && qdx < num_located; ++qdx)
+        {
+            const uint8_t * pattern = orig + offsets[qdx];
+            const int32_t * lo = std::lower_bound(SA, SA + str_size, pattern, [&](const int32_t sfx, const uint8_t * pat)
+            {
+                const int32_t len = str_size - sfx < length ? str_size - sfx : length;
+                const int cmp = memcmp(orig + sfx, pat, len);
+                return cmp < 0 || (cmp == 0 && len < length);
+            });
+            const int32_t * hi = std::upper_bound(SA, SA + str_size, pattern, [&](const uint8_t * pat, const int32_t sfx)
+            {
+                const int32_t len = str_size - sfx < length ? str_size - sfx : length;
+                return memcmp(pat, orig + sfx, len) < 0;
+            });
+            const int32_t num_hits = index.locate(pattern, length, hits, str_size);
+            same = same && num_hits == hi - lo && index.count(pattern, length) == num_hits;
+            std::sort(hits, hits + num_hits);
+            std::vector<int32_t> expected(lo, hi);
+            std::sort(expected.begin(), expected.end());
+            for (int32_t hdx = 0; same && hdx < num_hits; ++hdx)
+                same = same && hits[hdx] == expected[hdx];
+
+            same = same && index.extract(offsets[qdx], length, text) && memcmp(text, pattern, length) == 0;
+        }
+    }
+
+    // Patterns which do not occur
+    const uint8_t absent[2] = { 0, 255 };
+    int32_t naive = 0;
+    for (int32_t odx = 0; odx + 1 < str_size; ++odx){ naive += orig[odx] == absent[0] && orig[odx + 1] == absent[1]; }
+    same = same && index.count(absent, 2) == naive;
+    same = same && index.extract(str_size - 1, 1, text) && text[0] == orig[str_size - 1];
+
+    delete [] SA;
+    delete [] offsets;
+    delete [] hits;
+    delete [] text;
+
+    std::cout << "Test " << name << (same ? " success!" : " fail!") << std::endl;
+    return same;
+}
+
+
+/*
+    Round trip of compress and decompress (all blocks, and one block by seeking), with MB/s and
+    compression ratio, next to bzip2 -9 when AISS4_HAVE_BZIP2 is defined.
+*/
+bool tester_compress(const std::string name, const uint8_t * orig, const int32_t str_size, const int32_t block_size, const int num_threads)
+{
+    std::cout << "Test " << name << std::endl;
 
+    std::vector<uint8_t> packed;
+    auto start = std::chrono::system_clock::now();
+    compress(orig, str_size, packed, block_size, num_threads);
+    auto end = std::chrono::system_clock::now();
+    double time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-9;
+    std::cout << "aiss4 compress   (size = " << str_size << ", block = " << block_size << ", threads = " << num_threads << ") = "
+              << str_size / time * 1e-6 << " MB/s, ratio = " << static_cast<double>(str_size) / packed.size() << std::endl;
+
+    uint8_t * decoded = new uint8_t[str_size];
+    start = std::chrono::system_clock::now();
+    bool same = decompress(packed.data(), packed.size(), decoded, num_threads);
+    end = std::chrono::system_clock::now();
+    time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-9;
+    std::cout << "aiss4 decompress (size = " << str_size << ", block = " << block_size << ", threads = " << num_threads << ") = "
+              << str_size / time * 1e-6 << " MB/s" << std::endl;
+
+    for (int32_t odx = 0; same && odx < str_size; ++odx)
+        same = same && decoded[odx] == orig[odx];
+
+    // Seek to the last block
+    const int64_t last = (static_cast<int64_t>(str_size) + block_size - 1) / block_size - 1;
+    const int32_t len  = decompress_block(packed.data(), packed.size(), last, decoded);
+    same = same && len == str_size - last * block_size && memcmp(decoded, orig + last * block_size, len) == 0;
+
+    // A damaged container is rejected
+    if (packed.size() > 100)
+    {
+        packed[packed.size() / 2] ^= 0x5A;
+        packed.resize(packed.size() - 1);
+        decompress(packed.data(), packed.size(), decoded, num_threads); // Must not crash
+        same = same && decompress_block(packed.data(), packed.size(), last, decoded) < 0;
+    }
+
+#ifdef AISS4_HAVE_BZIP2
+    unsigned int bz_size = str_size + str_size / 100 + 600;
+    char * bz_packed = new char[bz_size];
+    start = std::chrono::system_clock::now();
+    const int bz_error = BZ2_bzBuffToBuffCompress(bz_packed, &bz_size, reinterpret_cast<char *>(const_cast<uint8_t *>(orig)), str_size, 9, 0, 30);
+    end = std::chrono::system_clock::now();
+    time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-9;
+    if (bz_error == BZ_OK)
+    {
+        std::cout << "bzip2 compress   (size = " << str_size << ", -9) = " << str_size / time * 1e-6 << " MB/s, ratio = "
+                  << static_cast<double>(str_size) / bz_size << std::endl;
+        unsigned int bz_decoded = str_size;
+        start = std::chrono::system_clock::now();
+        BZ2_bzBuffToBuffDecompress(reinterpret_cast<char *>(decoded), &bz_decoded, bz_packed, bz_size, 0, 0);
+        end = std::chrono::system_clock::now();
+        time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-9;
+        std::cout << "bzip2 decompress (size = " << str_size << ", -9) = " << str_size / time * 1e-6 << " MB/s" << std::endl;
+    }
+    delete [] bz_packed;
+#endif
+
+    delete [] decoded;
+
+    std::cout << "Test " << name << (same ? " success!" : " fail!") << std::endl;
+    return same;
+}
+
+
+/*
+    Levels recorded by sais_stats (built with -DAISS4_STATS=1): each recursion is the reduced problem
+    of its parent, and attaching stats does not change the suffix array
+*/
+bool tester_stats(const std::string name, const uint8_t * orig, const int32_t str_size)
+{
+    std::cout << "Test " << name << std::endl;
+
+    int32_t * SA1 = new int32_t[str_size];
+    int32_t * SA2 = new int32_t[str_size];
+
+    auto start = std::chrono::system_clock::now();
+    sais(orig, SA1, str_size);
+    auto end = std::chrono::system_clock::now();
+    double time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    std::cout << "Time [ms] SA-IS  (size = " << str_size << ") = " << time << std::endl;
+
+    sais_stats stats;
+    sais_stats * previous = sais_stats_attach(&stats);
+    start = std::chrono::system_clock::now();
+    sais(orig, SA2, str_size);
+    end = std::chrono::system_clock::now();
+    sais_stats_attach(previous);
+    time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    std::cout << "Time [ms] SA-IS  (size = " << str_size << ", stats) = " << time << std::endl;
+    stats.report(std::cout);
+
+    bool same = !sais_stats_enabled || (!stats.levels.empty() && stats.levels[0].depth == 0 && stats.levels[0].str_size == str_size);
+    for (size_t lvl = 0; same && lvl < stats.levels.size(); ++lvl)
+    {
+        const sais_level & level = stats.levels[lvl];
+        same = 2 * level.num_lms <= level.str_size && level.name <= level.num_lms;
+        if (level.data_bytes > 0)
+        {
+            same = same && lvl + 1 < stats.levels.size();
+            same = same && stats.levels[lvl + 1].depth    == level.depth + 1;
+            same = same && stats.levels[lvl + 1].str_size == level.num_lms;
+            same = same && stats.levels[lvl + 1].abc_size == level.name;
+        }
+        else
+            same = same && (lvl + 1 == stats.levels.size());
+    }
+    for (int32_t sdx = 0; same && sdx < str_size; ++sdx)
+        same = same && SA1[sdx] == SA2[sdx];
+
+    delete [] SA1;
+    delete [] SA2;
+
+    std::cout << "Test " << name << (same ? " success!" : " fail!") << std::endl;
+    return same;
+}
+
+
+/*
+    Time of the naming step (Step 6, summed over the recursion levels, when built with
+    -DAISS4_STATS=1) and of the whole sais, verified with the decode round trip
+*/
+bool tester_naming(const std::string name, const uint8_t * orig, const int32_t str_size)
+{
+    std::cout << "Test " << name << std::endl;
+
+    int32_t * SA      = new int32_t[str_size];
+    uint8_t * encoded = new uint8_t[str_size];
+    uint8_t * decoded = new uint8_t[str_size];
+
+    sais_stats stats;
+    sais_stats * previous = sais_stats_attach(&stats);
+    auto start = std::chrono::system_clock::now();
+    sais(orig, SA, str_size);
+    auto end = std::chrono::system_clock::now();
+    sais_stats_attach(previous);
+    double time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    double naming = 0;
+    for (const sais_level & level : stats.levels){ naming += level.step_ms[6]; }
+    std::cout << "Time [ms] SA-IS  (size = " << str_size << ", " << (name_words ? "words" : "tokens") << ") = " << time
+              << ", naming = " << naming << ", levels = " << stats.levels.size() << std::endl;
+
+    const int32_t pointer = encode(orig, SA, encoded, str_size);
+    decode(pointer, encoded, decoded, str_size);
+    bool same = true;
+    for (int32_t odx = 0; same && odx < str_size; ++odx)
+        same = same && decoded[odx] == orig[odx];
+
+    delete [] SA;
+    delete [] encoded;
+    delete [] decoded;
+
+    std::cout << "Test " << name << (same ? " success!" : " fail!") << std::endl;
+    return same;
+}
+
+
+/*
+    sais_dna on orig packed with bits per symbol versus sais on the bytes; orig has to consist of
+    ACGT (bits = 2) or ACGNT (bits = 3)
+*/
+bool tester_dna(const std::string name, const uint8_t * orig, const int32_t str_size, const int bits, const int num_threads)
+{
+    std::cout << "Test " << name << std::endl;
+
+    int32_t  * SA     = new int32_t[str_size];
+    int32_t  * SA_dna = new int32_t[str_size];
+    const int64_t num_words = dna_words(str_size, bits);
+    uint64_t * packed = new uint64_t[num_words];
+
+    auto start = std::chrono::system_clock::now();
+    sais(orig, SA, str_size, num_threads);
+    auto end = std::chrono::system_clock::now();
+    double time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    std::cout << "Time [ms] SA-IS bytes   (size = " << str_size << ", threads = " << num_threads << ") = " << time << std::endl;
+
+    bool same = pack_dna(orig, str_size, packed, bits);
+    std::cout << "Packed text (" << bits << " bits) = " << sizeof(uint64_t) * num_words << " bytes" << std::endl;
+
+    start = std::chrono::system_clock::now();
+    sais_dna(packed, bits, SA_dna, str_size, num_threads);
+    end = std::chrono::system_clock::now();
+    time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    std::cout << "Time [ms] SA-IS packed  (size = " << str_size << ", threads = " << num_threads << ") = " << time << std::endl;
+
+    for (int32_t idx = 0; same && idx < str_size; ++idx)
+        same = SA[idx] == SA_dna[idx];
+
+    delete [] SA;
+    delete [] SA_dna;
+    delete [] packed;
+
+    std::cout << "Test " << name << (same ? " success!" : " fail!") << std::endl;
+    return same;
+}
+
+
+/*
+    csa against the suffix array of sais for each sample rate: memory of psi and of the samples,
+    latency of sa, isa and extract (random offsets), and the results of all three
+*/
+bool tester_csa(const std::string name, const uint8_t * orig, const int32_t str_size, const std::vector<int32_t> & rates)
+{
+    std::cout << "Test " << name << std::endl;
+
+    int32_t * SA = new int32_t[str_size];
+    sais(orig, SA, str_size);
+    std::cout << "Suffix array = " << sizeof(int32_t) * static_cast<size_t>(str_size) << " bytes" << std::endl;
+
+    std::mt19937 generator(42);
+    const int32_t num_queries = 100000;
+    const int32_t num_extract = 10000;
+    const int32_t ext_length  = 64;
+    int32_t * queries = new int32_t[num_queries];
+    uint8_t * text    = new uint8_t[ext_length];
+    for (int32_t qdx = 0; qdx < num_queries; ++qdx)
+        queries[qdx] = static_cast<int32_t>(generator() % static_cast<uint32_t>(str_size));
+    bool same = true;
+
+    for (const int32_t rate : rates)
+    {
+        auto start = std::chrono::system_clock::now();
+        csa<int32_t> index(orig, SA, str_size, rate);
+        auto end = std::chrono::system_clock::now();
+        double time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+        std::cout << "Sample rate " << rate << ": build [ms] = " << time
+                  << ", psi = " << 8.0 * index.psi_bytes() / str_size << " bits/symbol"
+                  << ", samples = " << 8.0 * index.sample_bytes() / str_size << " bits/symbol"
+                  << ", total = " << index.bytes() << " bytes" << std::endl;
+
+        int64_t check = 0;
+        start = std::chrono::system_clock::now();
+        for (int32_t qdx = 0; qdx < num_queries; ++qdx){ check += index.sa(queries[qdx]); }
+        end = std::chrono::system_clock::now();
+        const double sa_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / static_cast<double>(num_queries);
+
+        start = std::chrono::system_clock::now();
+        for (int32_t qdx = 0; qdx < num_queries; ++qdx){ check += index.isa(queries[qdx]); }
+        end = std::chrono::system_clock::now();
+        const double isa_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / static_cast<double>(num_queries);
+
+        start = std::chrono::system_clock::now();
+        for (int32_t qdx = 0; qdx < num_extract; ++qdx)
+        {
+            index.extract(queries[qdx] % (str_size - ext_length + 1), ext_length, text);
+            check += text[0];
+        }
+        end = std::chrono::system_clock::now();
+        const double ext_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / static_cast<double>(num_extract);
+        std::cout << "Sample rate " << rate << ": sa = " << sa_ns << " ns, isa = " << isa_ns << " ns, extract("
+                  << ext_length << ") = " << ext_ns << " ns (" << check % 2 << ")" << std::endl;
+
+        for (int32_t qdx = 0; same && qdx < num_queries; ++qdx)
+        {
+            const int32_t idx = queries[qdx];
+            same = index[idx] == SA[idx] && SA[index.isa(SA[idx])] == SA[idx];
+        }
+        for (int32_t qdx = 0; same && qdx < num_extract; ++qdx)
+        {
+            const int32_t pos = queries[qdx] % (str_size - ext_length + 1);
+            same = index.extract(pos, ext_length, text) && memcmp(text, orig + pos, ext_length) == 0;
+        }
+        same = same && index.extract(str_size - 1, 1, text) && text[0] == orig[str_size - 1];
+        same = same && index.isa(str_size - 1) >= 0 && SA[index.isa(str_size - 1)] == str_size - 1;
+    }
+
+    delete [] SA;
+    delete [] queries;
+    delete [] text;
+
+    std::cout << "Test " << name << (same ? " success!" : " fail!") << std::endl;
+    return same;
+}
+
+
+/*
+    sais_append of num_chunks equal chunks onto the suffix array of orig[0:base], against sais of
+    each prefix from scratch
+*/
+bool tester_append(const std::string name, const uint8_t * orig, const int32_t str_size, const int32_t base, const int32_t num_chunks)
+{
+    std::cout << "Test " << name << std::endl;
+
+    int32_t * SA   = new int32_t[str_size];
+    int32_t * full = new int32_t[str_size];
+
+    sais(orig, SA, base);
+    bool same = true;
+    const int32_t chunk = (str_size - base) / num_chunks;
+    for (int32_t cdx = 1; cdx <= num_chunks; ++cdx)
+    {
+        const int32_t old_size = base + (cdx - 1) * chunk;
+        const int32_t new_size = cdx == num_chunks ? str_size : base + cdx * chunk;
+
+        auto start = std::chrono::system_clock::now();
+        sais_append(orig, SA, old_size, new_size);
+        auto end = std::chrono::system_clock::now();
+        const double time_append = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+
+        start = std::chrono::system_clock::now();
+        sais(orig, full, new_size);
+        end = std::chrono::system_clock::now();
+        const double time_full = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+        std::cout << "Time [ms] append " << old_size << " -> " << new_size << " = " << time_append
+                  << ", full sais = " << time_full << std::endl;
+
+        for (int32_t idx = 0; same && idx < new_size; ++idx)
+            same = SA[idx] == full[idx];
+    }
+
+    delete [] SA;
+    delete [] full;
+
+    std::cout << "Test " << name << (same ? " success!" : " fail!") << std::endl;
+    return same;
+}
+
+
+/*
+    sais, encode and decode (twice) with the work arrays from each built-in allocator, and the
+    suffix array and decoded text of the caller in huge pages for the huge page modes
+*/
+/*
+    Heap allocator which counts its calls, the ones of other threads than the creator, and the
+    bytes in use
+*/
+class counting_allocator : public sais_allocator
+{
+    public:
+
+        counting_allocator() : creator(std::this_thread::get_id()), calls(0), foreign(0), live(0) {}
+
+        void * allocate(const size_t bytes)
+        {
+            ++calls;
+            if (std::this_thread::get_id() != creator)
+                ++foreign;
+            live += static_cast<int64_t>(bytes);
+            return malloc(bytes > 0 ? bytes : 1);
+        }
+
+        void deallocate(void * ptr, const size_t bytes)
+        {
+            live -= static_cast<int64_t>(bytes);
+            free(ptr);
+        }
+
+        const std::thread::id creator;
+        std::atomic<int64_t>  calls;
+        std::atomic<int64_t>  foreign;
+        std::atomic<int64_t>  live;
+
+};
+
+
+bool tester_allocator(const std::string name, const uint8_t * orig, const int32_t str_size)
+{
+    std::cout << "Test " << name << std::endl;
+
+    int32_t * reference = new int32_t[str_size];
+    sais(orig, reference, str_size);
+
+    const size_t sa_bytes = sizeof(int32_t) * static_cast<size_t>(str_size);
+    const std::string names[5] = { "heap", "pages", "transparent huge pages", "MAP_HUGETLB", "arena (transparent huge pages)" };
+    bool same = true;
+    for (int mode = 0; mode < 5; ++mode)
+    {
+        page_allocator  pages(mode == 4 ? 1 : (mode > 0 ? mode - 1 : 0));
+        arena_allocator arena(mode == 4 ? sa_bytes + sa_bytes / 4 : 0, 1);
+        sais_allocator * alloc = mode == 0 ? NULL : (mode == 4 ? static_cast<sais_allocator *>(&arena) : static_cast<sais_allocator *>(&pages));
+        const int buffer_mode = mode >= 2 ? 1 : 0;
+        int32_t * SA      = buffer_mode ? static_cast<int32_t *>(map_pages(sa_bytes, buffer_mode)) : new int32_t[str_size];
+        uint8_t * encoded = new uint8_t[str_size];
+        uint8_t * decoded = buffer_mode ? static_cast<uint8_t *>(map_pages(str_size, buffer_mode)) : new uint8_t[str_size];
+
+        sais_allocator * previous = sais_allocator_attach(alloc);
+        for (int rep = 0; rep < 2; ++rep)
+        {
+            auto start = std::chrono::system_clock::now();
+            sais(orig, SA, str_size);
+            auto end = std::chrono::system_clock::now();
+            const double time_sais = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+
+            const int32_t pointer = encode(orig, SA, encoded, str_size);
+            start = std::chrono::system_clock::now();
+            decode(pointer, encoded, decoded, str_size);
+            end = std::chrono::system_clock::now();
+            const double time_decode = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+            std::cout << "Time [ms] " << names[mode] << " (call " << rep + 1 << "): SA-IS = " << time_sais << ", decode = " << time_decode << std::endl;
+
+            for (int32_t idx = 0; same && idx < str_size; ++idx)
+                same = SA[idx] == reference[idx] && decoded[idx] == orig[idx];
+        }
+        sais_allocator_attach(previous);
+        if (mode == 4)
+            std::cout << "Arena high water = " << arena.high_water() << " bytes" << std::endl;
+
+        if (buffer_mode){ unmap_pages(SA, sa_bytes); } else { delete [] SA; }
+        if (buffer_mode){ unmap_pages(decoded, str_size); } else { delete [] decoded; }
+        delete [] encoded;
+    }
+
+    // The threads of sais_batch and the workspace (bucket arrays and type bitmap) use the attached allocator as well
+    {
+        const int64_t num_records = 1024;
+        const int64_t record_size = str_size / num_records < 4096 ? str_size / num_records : 4096;
+        std::vector<int64_t> offsets(num_records + 1);
+        for (int64_t rec = 0; rec <= num_records; ++rec){ offsets[rec] = rec * record_size; }
+        std::vector<int32_t> batch(static_cast<size_t>(num_records * record_size));
+        std::vector<int32_t> check(static_cast<size_t>(num_records * record_size));
+        sais_batch(orig, offsets.data(), num_records, check.data(), 1);
+
+        counting_allocator counter;
+        sais_allocator * previous = sais_allocator_attach(&counter);
+        same = sais_batch(orig, offsets.data(), num_records, batch.data(), 4) && same;
+        const int64_t batch_calls = counter.calls;
+        {
+            sais_workspace<int32_t> workspace;
+            workspace.reserve(1 << 16);
+            sais_allocator_attach(previous); // released by the allocator which reserved it
+        }
+        std::cout << "Counting allocator: " << counter.calls << " calls, " << counter.foreign << " from other threads, " << counter.live << " bytes left" << std::endl;
+        same = same && batch == check && counter.foreign > 0 && counter.calls == batch_calls + 3 && counter.live == 0;
+    }
+
+    delete [] reference;
+
+    std::cout << "Test " << name << (same ? " success!" : " fail!") << std::endl;
+    return same;
+}
+
+
+/*
+    sais_sharded with each number of workers against sais: wall time, and the sum over the phases
+    of the largest CPU time of a worker, i.e. the time with a core per worker
+*/
+bool tester_sharded(const std::string name, const uint8_t * orig, const int32_t str_size, const std::vector<int> & workers)
+{
+    std::cout << "Test " << name << std::endl;
+
+    int32_t * reference = new int32_t[str_size];
+    int32_t * SA        = new int32_t[str_size];
+
+    auto start = std::chrono::system_clock::now();
+    sais(orig, reference, str_size);
+    auto end = std::chrono::system_clock::now();
+    double time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    if (str_size >= 1024 * 1024)
+        std::cout << "Time [ms] sais = " << time << " (" << 1e-3 * str_size / time << " MB/s)" << std::endl;
+
+    bool same = true;
+    for (const int num_workers : workers)
+    {
+        double phase_seconds[shard_job<int32_t>::num_phases];
+        start = std::chrono::system_clock::now();
+        const bool built = sais_sharded_implementation<int32_t>(orig, SA, str_size, num_workers, phase_seconds);
+        end = std::chrono::system_clock::now();
+        time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+        double critical = 0.0; // with a core per worker
+        for (const double seconds : phase_seconds){ critical += 1e3 * seconds; }
+        if (str_size >= 1024 * 1024)
+            std::cout << "Time [ms] sais_sharded with " << num_workers << " workers = " << time << " (" << 1e-3 * str_size / time << " MB/s)"
+                      << ", slowest worker per phase = " << critical << " (" << 1e-3 * str_size / critical << " MB/s)" << std::endl;
+
+        same = same && built;
+        for (int32_t idx = 0; same && idx < str_size; ++idx)
+            same = SA[idx] == reference[idx];
+    }
+
+    delete [] reference;
+    delete [] SA;
+
+    std::cout << "Test " << name << (same ? " success!" : " fail!") << std::endl;
+    return same;
+}
+
+
+/*
+    sais_check, bwt_check and bwt_check_lean accept the output of sais and encode, and reject it
+    after swapping two suffix array entries, moving the primary index or changing a BWT symbol
+*/
+bool tester_check(const std::string name, const uint8_t * orig, const int32_t str_size, const int32_t num_changes)
+{
+    std::cout << "Test " << name << std::endl;
+
+    int32_t * SA      = new int32_t[str_size];
+    uint8_t * encoded = new uint8_t[str_size];
+    sais(orig, SA, str_size);
+    const int32_t pointer = encode(orig, SA, encoded, str_size);
+
+    auto start = std::chrono::system_clock::now();
+    bool same = sais_check(orig, SA, str_size);
+    auto end = std::chrono::system_clock::now();
+    const double time_sa = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    start = std::chrono::system_clock::now();
+    same = bwt_check(orig, SA, encoded, pointer, str_size) && same;
+    end = std::chrono::system_clock::now();
+    const double time_bwt = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    start = std::chrono::system_clock::now();
+    same = bwt_check_lean(orig, encoded, pointer, str_size, 8) && same;
+    end = std::chrono::system_clock::now();
+    const double time_lean = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    if (str_size >= 1024 * 1024)
+        std::cout << "Time [ms] sais_check = " << time_sa << ", bwt_check = " << time_bwt << ", bwt_check_lean = " << time_lean << std::endl;
+
+    std::mt19937 generator(42);
+    for (int32_t change = 0; same && change < num_changes && str_size > 1; ++change)
+    {
+        const int32_t left  = static_cast<int32_t>(generator() % static_cast<uint32_t>(str_size));
+        const int32_t right = change % 2 == 0 ? (left + 1) % str_size : static_cast<int32_t>(generator() % static_cast<uint32_t>(str_size));
+        if (left != right)
+        {
+            std::swap(SA[left], SA[right]);
+            same = !sais_check(orig, SA, str_size);
+            std::swap(SA[left], SA[right]);
+        }
+        const int32_t moved = pointer + (change % 2 == 0 ? 1 : -1);
+        same = same && !bwt_check(orig, SA, encoded, moved, str_size) && !bwt_check_lean(orig, encoded, moved, str_size, 8);
+        const uint8_t symbol = encoded[left];
+        encoded[left] = static_cast<uint8_t>(symbol + 1 + generator() % 255);
+        same = same && !bwt_check(orig, SA, encoded, pointer, str_size) && !bwt_check_lean(orig, encoded, pointer, str_size, 8);
+        encoded[left] = symbol;
+    }
+    same = same && sais_check(orig, SA, str_size) && bwt_check_lean(orig, encoded, pointer, str_size, 8);
+
+    delete [] SA;
+    delete [] encoded;
+
+    std::cout << "Test " << name << (same ? " success!" : " fail!") << std::endl;
+    return same;
+}
+
+
+/*
+    sais with engine_twostage and engine_auto gives the suffix array of engine_induce, for int32_t,
+    int64_t and int40_t suffix arrays and for sais_bwt
+*/
+bool tester_engine(const std::string name, const uint8_t * orig, const int32_t str_size)
+{
+    std::cout << "Test " << name << std::endl;
+
+    const std::string names[3] = { "induce", "twostage", "auto" };
+    const sais_engine engines[3] = { engine_induce, engine_twostage, engine_auto };
+    int32_t * reference = new int32_t[str_size];
+    int32_t * SA        = new int32_t[str_size];
+
+    bool same = true;
+    for (int eng = 0; eng < 3; ++eng)
+    {
+        auto start = std::chrono::system_clock::now();
+        sais(orig, eng == 0 ? reference : SA, str_size, 1, engines[eng]);
+        auto end = std::chrono::system_clock::now();
+        const double time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+        if (str_size >= 1024 * 1024)
+            std::cout << "Time [ms] sais " << names[eng] << " = " << time << " (" << 1e-3 * str_size / time << " MB/s)" << std::endl;
+        for (int32_t idx = 0; eng > 0 && same && idx < str_size; ++idx)
+            same = SA[idx] == reference[idx];
+    }
+
+    int64_t * SA64 = new int64_t[str_size];
+    sais(orig, SA64, static_cast<int64_t>(str_size), 1, engine_twostage);
+    for (int32_t idx = 0; same && idx < str_size; ++idx)
+        same = SA64[idx] == reference[idx];
+    delete [] SA64;
+
+    int40_t * SA40 = new int40_t[str_size];
+    sais(orig, SA40, static_cast<int64_t>(str_size), 1, engine_twostage);
+    for (int32_t idx = 0; same && idx < str_size; ++idx)
+        same = static_cast<int64_t>(SA40[idx]) == reference[idx];
+    delete [] SA40;
+
+    uint8_t * encoded = new uint8_t[str_size];
+    uint8_t * direct  = new uint8_t[str_size];
+    const int32_t pointer = encode(orig, reference, encoded, str_size);
+    same = same && sais_bwt(orig, direct, SA, str_size, 1, engine_twostage) == pointer && memcmp(encoded, direct, str_size) == 0;
+    delete [] encoded;
+    delete [] direct;
+
+    delete [] reference;
+    delete [] SA;
+
+    std::cout << "Test " << name << (same ? " success!" : " fail!") << std::endl;
+    return same;
+}
+
+
+/*
+    classify_types of bytes against the definition of the suffix types and a plain histogram, on
+    every prefix of up to 200 bytes at 8 byte offsets of orig (word boundaries and unaligned loads),
+    and on orig itself; then sais on orig, verified with sais_check. test29 runs it with the AVX2,
+    SSE2 and scalar comparisons.
+*/
+bool tester_types(const std::string name, const uint8_t * orig, const int32_t str_size)
+{
+    std::cout << "Test " << name << std::endl;
+
+    uint64_t * stype  = new uint64_t[str_size / 64 + 1];
+    int32_t  * count  = new int32_t[256];
+    int32_t  * counts = new int32_t[256];
+    bool same = true;
+
+    auto verify = [&](const uint8_t * text, const int32_t size)
+    {
+        classify_types(text, size, stype, count, static_cast<int32_t>(256));
+        bool next = false; // text[size - 1] is L-type
+        for (int32_t chr = 0; chr < 256; ++chr){ counts[chr] = 0; }
+        for (int32_t odx = size - 1; same && odx >= 0; --odx)
+        {
+            next = odx < size - 1 && (text[odx] < text[odx + 1] || (text[odx] == text[odx + 1] && next));
+            same = ((stype[odx >> 6] >> (odx & 63)) & 1) == static_cast<uint64_t>(next);
+            ++counts[text[odx]];
+        }
+        for (int32_t odx = size; same && odx < (size / 64 + 1) * 64; ++odx)
+            same = ((stype[odx >> 6] >> (odx & 63)) & 1) == 0;
+        same = same && memcmp(count, counts, 256 * sizeof(int32_t)) == 0;
+    };
+
+    for (int32_t shift = 0; same && shift < 8 && shift < str_size; ++shift)
+        for (int32_t size = 1; same && size <= 200 && shift + size <= str_size; ++size)
+            verify(orig + shift, size);
+    if (same)
+        verify(orig, str_size);
+    std::cout << "Types and counts = " << (same ? "equal" : "different") << std::endl;
+
+    int32_t * SA = new int32_t[str_size];
+    auto start = std::chrono::system_clock::now();
+    sais(orig, SA, str_size);
+    auto end = std::chrono::system_clock::now();
+    const double time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-6;
+    std::cout << "Time [ms] SA-IS  (size = " << str_size << ") = " << time << std::endl;
+    same = same && sais_check(orig, SA, str_size);
+
+    delete [] stype;
+    delete [] count;
+    delete [] counts;
+    delete [] SA;
+
+    std::cout << "Test " << name << (same ? " success!" : " fail!") << std::endl;
+    return same;
+}
+
+
+} // End of namespace aiss4
@@ -0,0 +1,46 @@
+/*
+    aiss4: suffix array via induced sorting
+
+    Copyright (c) 2020, Sebastian Wouters
+    All rights reserved.
+
+    This file is part of aiss4, licensed under the BSD 3-Clause License.
+    A copy of the License can be found in the file LICENSE in the root
+    folder of this project.
+*/
+
+#include "tester.hpp"
+
+
+int main()
+{
+    const int32_t size = 50000;
+    uint16_t * words = new uint16_t[size];
+    uint32_t * codes = new uint32_t[size];
+
+    // Skewed word IDs with copied phrases, and k-mer codes of a small text
+    uint32_t state = 12345;
+    for (int32_t odx = 0; odx < size; ++odx)
+    {
+        state = state * 1103515245 + 12345;
+        const uint32_t rnd = (state >> 8) % 1000;
+        words[odx] = static_cast<uint16_t>(odx >= 100 && rnd < 300 ? words[odx - 100 + rnd % 7] : rnd * rnd / 1000);
+    }
+    for (int32_t odx = 0; odx < size; ++odx)
+    {
+        uint32_t kmer = 0;
+        for (int32_t cnt = 0; cnt < 8; ++cnt)
+            kmer = 4 * kmer + (odx + cnt < size ? words[odx + cnt] % 4 : 0);
+        codes[odx] = kmer;
+    }
+
+    aiss4::sais_workspace<int32_t> workspace;
+    bool success = aiss4::tester_integer("uint16_t words", words, 1000, size, workspace);
+    success = aiss4::tester_integer("uint32_t 8-mers", codes, 65536, size, workspace) && success;
+    success = aiss4::tester_integer("uint16_t words (reused workspace)", words, 1000, size, workspace) && success;
+
+    delete [] words;
+    delete [] codes;
+
+    return success ? 0 : 255;
+}
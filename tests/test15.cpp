@@ -0,0 +1,48 @@
+/*
+    aiss4: suffix array via induced sorting
+
+    Copyright (c) 2020, Sebastian Wouters
+    All rights reserved.
+
+    This file is part of aiss4, licensed under the BSD 3-Clause License.
+    A copy of the License can be found in the file LICENSE in the root
+    folder of this project.
+*/
+
+#include "tester.hpp"
+
+
+int main()
+{
+    // banana, ananas, (empty), nab, banana
+    const int32_t num_docs = 5;
+    const int32_t offsets[num_docs + 1] = { 0, 6, 12, 12, 15, 21 };
+    const uint8_t orig[21] = { 'b', 'a', 'n', 'a', 'n', 'a',
+                               'a', 'n', 'a', 'n', 'a', 's',
+                               'n', 'a', 'b',
+                               'b', 'a', 'n', 'a', 'n', 'a' };
+    bool success = aiss4::tester_generalized("banana, ananas, , nab, banana", orig, offsets, num_docs);
+
+    // Many short documents over a small alphabet, so that suffixes often tie up to a document end
+    const int32_t many = 70000;
+    int32_t * bounds = new int32_t[many + 1];
+    bounds[0] = 0;
+    uint32_t state = 12345;
+    for (int32_t doc = 0; doc < many; ++doc)
+    {
+        state = state * 1103515245 + 12345;
+        bounds[doc + 1] = bounds[doc] + (state >> 16) % 8;
+    }
+    uint8_t * text = new uint8_t[bounds[many]];
+    for (int32_t odx = 0; odx < bounds[many]; ++odx)
+    {
+        state = state * 1103515245 + 12345;
+        text[odx] = 'a' + (state >> 16) % 3;
+    }
+    success = aiss4::tester_generalized("70000 documents", text, bounds, many) && success;
+
+    delete [] bounds;
+    delete [] text;
+
+    return success ? 0 : 255;
+}
@@ -0,0 +1,23 @@
+/*
+    aiss4: suffix array via induced sorting
+
+    Copyright (c) 2020, Sebastian Wouters
+    All rights reserved.
+
+    This file is part of aiss4, licensed under the BSD 3-Clause License.
+    A copy of the License can be found in the file LICENSE in the root
+    folder of this project.
+*/
+
+#include "tester.hpp"
+
+
+int main()
+{
+    const int32_t size = 7;
+    const uint8_t orig[size] = { 'b', 'a', 'b', 'b', 'a', 'b', 'b' };
+
+    bool success = aiss4::tester("babbabb", orig, size, true);
+
+    return success ? 0 : 255;
+}
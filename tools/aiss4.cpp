@@ -0,0 +1,236 @@
+/*
+    aiss4: suffix array via induced sorting
+
+    Copyright (c) 2020, Sebastian Wouters
+    All rights reserved.
+
+    This file is part of aiss4, licensed under the BSD 3-Clause License.
+    A copy of the License can be found in the file LICENSE in the root
+    folder of this project.
+*/
+
+#include "bwt.hpp"
+#include "sais.hpp"
+#include "sais_check.hpp"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <iostream>
+#include <string>
+#include <chrono>
+
+
+/*
+    aiss4 [--bwt] [--int40] [--threads num] [--engine name] [--check] [--stats] input output
+
+    The input file is memory-mapped. Without --bwt, output becomes the suffix array of input as
+    int32_t (input smaller than 2 GB) or int64_t (otherwise, or the 5-byte int40_t of int40.hpp with
+    --int40, for inputs up to 2^39 - 1 bytes), written in place in a memory-mapped output file. With
+    --bwt, output becomes the int64_t primary index followed by the BWT of input (same format as
+    encode in bwt.hpp), built with sais_bwt and an in-memory workspace. --engine selects the sort of
+    the LMS substrings (induce, twostage or auto of sais_engine.hpp), with the same output. With
+    --check, the output is verified in linear time before it is unmapped (sais_check, or
+    bwt_check_lean for --bwt), and a failed check returns 4. The time of --stats excludes the check,
+    which is reported on its own line.
+*/
+void usage(const char * prog)
+{
+    std::cerr << "Usage: " << prog << " [--bwt] [--int40] [--threads num] [--engine name] [--check] [--stats] input output" << std::endl;
+    std::cerr << "  --bwt          write the primary index (int64_t) and the BWT instead of the suffix array" << std::endl;
+    std::cerr << "  --int40        write 5-byte suffixes instead of int64_t for inputs of 2 GB up to 2^39 - 1 bytes" << std::endl;
+    std::cerr << "  --threads num  number of threads for the induction sweeps (default 1)" << std::endl;
+    std::cerr << "  --engine name  induce (default), twostage or auto for the LMS substring sort" << std::endl;
+    std::cerr << "  --check        verify the suffix array or BWT in linear time" << std::endl;
+    std::cerr << "  --stats        report the time, throughput and peak resident set size" << std::endl;
+}
+
+
+// Map size bytes of the output file, sized with ftruncate
+uint8_t * map_output(const int fd, const size_t size)
+{
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+        return NULL;
+    if (size == 0)
+        return NULL;
+    void * ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    return ptr == MAP_FAILED ? NULL : reinterpret_cast<uint8_t *>(ptr);
+}
+
+
+// Clock of the construction (end, taken before the check) and of the check
+typedef std::chrono::steady_clock::time_point time_point;
+
+
+template <class index_t>
+bool run_bwt(const uint8_t * orig, const index_t size, const int fd, const int num_threads, const aiss4::sais_engine engine, const bool check, bool & valid, time_point & end, time_point & checked)
+{
+    uint8_t * out = map_output(fd, sizeof(int64_t) + static_cast<size_t>(size));
+    if (out == NULL)
+        return false;
+    index_t * suffix = new index_t[size];
+    const int64_t pointer = aiss4::sais_bwt(orig, out + sizeof(int64_t), suffix, size, num_threads, engine);
+    memcpy(out, &pointer, sizeof(int64_t));
+    delete [] suffix;
+    end = std::chrono::steady_clock::now();
+    valid = !check || aiss4::bwt_check_lean(orig, out + sizeof(int64_t), static_cast<index_t>(pointer), size, 10);
+    checked = std::chrono::steady_clock::now();
+    return munmap(out, sizeof(int64_t) + static_cast<size_t>(size)) == 0;
+}
+
+
+// length_t is the size argument of the matching sais overload (int64_t for int40_t)
+template <class index_t, class length_t>
+bool run_sa(const uint8_t * orig, const length_t size, const int fd, const int num_threads, const aiss4::sais_engine engine, const bool check, bool & valid, time_point & end, time_point & checked)
+{
+    const size_t bytes = sizeof(index_t) * static_cast<size_t>(size);
+    uint8_t * out = map_output(fd, bytes);
+    if (out == NULL)
+        return false;
+    aiss4::sais(orig, reinterpret_cast<index_t *>(out), size, num_threads, engine);
+    end = std::chrono::steady_clock::now();
+    valid = !check || aiss4::sais_check(orig, reinterpret_cast<const index_t *>(out), size);
+    checked = std::chrono::steady_clock::now();
+    return munmap(out, bytes) == 0;
+}
+
+
+int main(int argc, char ** argv)
+{
+    bool bwt    = false;
+    bool packed = false;
+    bool stats  = false;
+    bool check  = false;
+    int  num_threads = 1;
+    int  engine = aiss4::engine_induce;
+    const char * files[2] = { NULL, NULL };
+    int num_files = 0;
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (strcmp(argv[arg], "--bwt") == 0)
+            bwt = true;
+        else if (strcmp(argv[arg], "--int40") == 0)
+            packed = true;
+        else if (strcmp(argv[arg], "--check") == 0)
+            check = true;
+        else if (strcmp(argv[arg], "--stats") == 0)
+            stats = true;
+        else if (strcmp(argv[arg], "--threads") == 0 && arg + 1 < argc)
+            num_threads = atoi(argv[++arg]);
+        else if (strcmp(argv[arg], "--engine") == 0 && arg + 1 < argc)
+        {
+            const char * name = argv[++arg];
+            engine = strcmp(name, "induce") == 0 ? aiss4::engine_induce : (strcmp(name, "twostage") == 0 ? aiss4::engine_twostage : (strcmp(name, "auto") == 0 ? aiss4::engine_auto : -1));
+        }
+        else if (argv[arg][0] != '-' && num_files < 2)
+            files[num_files++] = argv[arg];
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (num_files != 2 || num_threads < 1 || engine < 0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // Step 1: Map the input
+    const int fd_in = open(files[0], O_RDONLY);
+    struct stat info;
+    if (fd_in < 0 || fstat(fd_in, &info) != 0)
+    {
+        std::cerr << "Cannot open " << files[0] << std::endl;
+        return 2;
+    }
+    const int64_t size = static_cast<int64_t>(info.st_size);
+    const uint8_t * orig = NULL;
+    if (size > 0)
+    {
+        void * ptr = mmap(NULL, static_cast<size_t>(size), PROT_READ, MAP_PRIVATE, fd_in, 0);
+        if (ptr == MAP_FAILED)
+        {
+            std::cerr << "Cannot map " << files[0] << std::endl;
+            close(fd_in);
+            return 2;
+        }
+        madvise(ptr, static_cast<size_t>(size), MADV_WILLNEED);
+        orig = reinterpret_cast<const uint8_t *>(ptr);
+    }
+
+    // Step 2: Create the output, refusing inputs which do not fit the 40-bit suffixes
+    if (packed && !bwt && size > aiss4::int40_max)
+    {
+        std::cerr << "Input " << files[0] << " exceeds the 2^39 - 1 bytes of --int40" << std::endl;
+        if (orig) { munmap(const_cast<uint8_t *>(orig), static_cast<size_t>(size)); }
+        close(fd_in);
+        return 1;
+    }
+    const int fd_out = open(files[1], O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_out < 0)
+    {
+        std::cerr << "Cannot create " << files[1] << std::endl;
+        if (orig) { munmap(const_cast<uint8_t *>(orig), static_cast<size_t>(size)); }
+        close(fd_in);
+        return 2;
+    }
+
+    // Step 3: Suffix array or BWT, with int32_t indices if possible
+    const int index_bytes = size <= INT32_MAX ? 4 : (packed ? 5 : 8);
+    const time_point start = std::chrono::steady_clock::now();
+    time_point end     = start;
+    time_point checked = start;
+    bool success = true;
+    bool valid   = true;
+    if (size == 0)
+    {
+        const int64_t pointer = -1;
+        success = !bwt || write(fd_out, &pointer, sizeof(int64_t)) == sizeof(int64_t);
+    }
+    else if (bwt && size <= INT32_MAX)
+        success = run_bwt<int32_t>(orig, static_cast<int32_t>(size), fd_out, num_threads, static_cast<aiss4::sais_engine>(engine), check, valid, end, checked);
+    else if (bwt)
+        success = run_bwt<int64_t>(orig, size, fd_out, num_threads, static_cast<aiss4::sais_engine>(engine), check, valid, end, checked);
+    else if (index_bytes == 4)
+        success = run_sa<int32_t>(orig, static_cast<int32_t>(size), fd_out, num_threads, static_cast<aiss4::sais_engine>(engine), check, valid, end, checked);
+    else if (index_bytes == 5)
+        success = run_sa<aiss4::int40_t>(orig, size, fd_out, num_threads, static_cast<aiss4::sais_engine>(engine), check, valid, end, checked);
+    else
+        success = run_sa<int64_t>(orig, size, fd_out, num_threads, static_cast<aiss4::sais_engine>(engine), check, valid, end, checked);
+
+    if (orig) { munmap(const_cast<uint8_t *>(orig), static_cast<size_t>(size)); }
+    close(fd_in);
+    success = close(fd_out) == 0 && success;
+    if (!success)
+    {
+        std::cerr << "Cannot write " << files[1] << std::endl;
+        return 3;
+    }
+    if (!valid)
+    {
+        std::cerr << "Check failed for " << files[1] << std::endl;
+        return 4;
+    }
+
+    if (stats)
+    {
+        const double time = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-9;
+        struct rusage resources;
+        getrusage(RUSAGE_SELF, &resources);
+        std::cout << "Size [bytes]      = " << size << std::endl;
+        std::cout << "Index [bytes]     = " << index_bytes << std::endl;
+        std::cout << "Time [s]          = " << time << std::endl;
+        std::cout << "Throughput [MB/s] = " << (time > 0 ? size / time * 1e-6 : 0) << std::endl;
+        std::cout << "Peak RSS [MB]     = " << resources.ru_maxrss / 1024.0 << std::endl;
+        if (check)
+            std::cout << "Check time [s]    = " << std::chrono::duration_cast<std::chrono::nanoseconds>(checked - end).count() * 1e-9 << std::endl;
+    }
+
+    return 0;
+}
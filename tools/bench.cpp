@@ -0,0 +1,280 @@
+/*
+    aiss4: suffix array via induced sorting
+
+    Copyright (c) 2020, Sebastian Wouters
+    All rights reserved.
+
+    This file is part of aiss4, licensed under the BSD 3-Clause License.
+    A copy of the License can be found in the file LICENSE in the root
+    folder of this project.
+*/
+
+#include "bwt.hpp"
+#include "sais.hpp"
+#include "sais_check.hpp"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+
+/*
+    aiss4_bench [--repeat num] [--size bytes] [--threads list] [--csv file] [files]
+
+    Benchmarks sais, encode and decode on generated worst cases of --size bytes (random bytes,
+    all-equal, Fibonacci word, periodic, repetitive DNA) and on the given files (e.g. chr22.dna and
+    etext99 of the Manzini corpus), and sais with engine_twostage and engine_auto of sais_engine.hpp
+    (sais.twostage and sais.auto) for the crossovers with engine_induce. The suffix arrays of all
+    three sais operations are checked with sais_check, and decode against the input.
+    Every (input, operation) pair runs in its own child process, so that the peak resident set size
+    belongs to that pair only; the median of --repeat runs is reported in MB/s and ns/byte. With
+    --csv, the results are also written as comma-separated values. --threads takes a comma-separated
+    list (e.g. 1,2,4,8,16): the sais operations run for every count, with the speedup over the first
+    count (make scaling), and encode and decode, which do not use threads, for the first count only.
+*/
+void usage(const char * prog)
+{
+    std::cerr << "Usage: " << prog << " [--repeat num] [--size bytes] [--threads list] [--csv file] [files]" << std::endl;
+    std::cerr << "  --repeat num   runs per operation, the median is reported (default 5)" << std::endl;
+    std::cerr << "  --size bytes   size of the generated inputs (default 16777216)" << std::endl;
+    std::cerr << "  --threads list comma-separated numbers of threads for sais (default 1)" << std::endl;
+    std::cerr << "  --csv file     also write the results as comma-separated values" << std::endl;
+}
+
+
+const char * operations[5] = { "sais", "encode", "decode", "sais.twostage", "sais.auto" };
+
+const char * generated[5] = { "random", "equal", "fibonacci", "periodic", "dna.repetitive" };
+
+
+// Generated input of size bytes, or the contents of the file name, limited to INT32_MAX bytes
+std::vector<uint8_t> make_input(const std::string name, const int32_t size)
+{
+    std::vector<uint8_t> text;
+    std::mt19937 generator(42);
+    if (name == "random")
+    {
+        text.resize(size);
+        for (int32_t idx = 0; idx < size; ++idx){ text[idx] = static_cast<uint8_t>(generator()); }
+    }
+    else if (name == "equal")
+        text.assign(size, 'a');
+    else if (name == "fibonacci")
+    {
+        // s(n) = s(n - 1) s(n - 2), in place: the prefix of length |s(n - 2)| follows s(n - 1)
+        text.resize(size);
+        if (size > 0){ text[0] = 'a'; }
+        if (size > 1){ text[1] = 'b'; }
+        int32_t prev = 1;
+        int32_t curr = 2;
+        while (curr < size)
+        {
+            const int32_t stop = curr + prev < size ? curr + prev : size;
+            for (int32_t idx = curr; idx < stop; ++idx){ text[idx] = text[idx - curr]; }
+            prev = curr;
+            curr = stop;
+        }
+    }
+    else if (name == "periodic")
+    {
+        const int32_t period = 1000;
+        text.resize(size);
+        for (int32_t idx = 0; idx < size && idx < period; ++idx){ text[idx] = static_cast<uint8_t>('a' + generator() % 26); }
+        for (int32_t idx = period; idx < size; ++idx){ text[idx] = text[idx - period]; }
+    }
+    else if (name == "dna.repetitive")
+    {
+        // Copies of one 1 MB genome with 0.1% point mutations
+        const char * bases = "ACGT";
+        const int32_t genome = 1 << 20;
+        text.resize(size);
+        for (int32_t idx = 0; idx < size && idx < genome; ++idx){ text[idx] = bases[generator() & 3]; }
+        for (int32_t idx = genome; idx < size; ++idx)
+            text[idx] = generator() % 1000 == 0 ? bases[generator() & 3] : text[idx - genome];
+    }
+    else
+    {
+        std::ifstream reader(name, std::ios::binary | std::ios::ate);
+        if (!reader.is_open())
+            return text;
+        const int64_t bytes = reader.tellg();
+        text.resize(static_cast<size_t>(bytes < INT32_MAX ? bytes : INT32_MAX));
+        reader.seekg(0);
+        reader.read(reinterpret_cast<char *>(text.data()), text.size());
+    }
+    return text;
+}
+
+
+// Median time [s] of repeat runs of op on name, and the input size in bytes; run in a child process
+double run_operation(const std::string name, const int32_t gen_size, const int op, const int repeat, const int num_threads, double & bytes)
+{
+    const std::vector<uint8_t> text = make_input(name, gen_size);
+    const int32_t size = static_cast<int32_t>(text.size());
+    bytes = static_cast<double>(size);
+    if (size < 1)
+        return -1.0;
+
+    int32_t * suffix  = new int32_t[size];
+    uint8_t * encoded = new uint8_t[size];
+    uint8_t * decoded = op == 2 ? new uint8_t[size] : NULL;
+    int32_t pointer = 0;
+    if (op == 1 || op == 2)
+    {
+        aiss4::sais(text.data(), suffix, size, num_threads);
+        pointer = aiss4::encode(text.data(), suffix, encoded, size);
+    }
+    if (op == 2)
+    {
+        delete [] suffix;
+        suffix = NULL;
+    }
+
+    std::vector<double> times;
+    for (int run = 0; run < repeat; ++run)
+    {
+        auto start = std::chrono::steady_clock::now();
+        if (op == 0)
+            aiss4::sais(text.data(), suffix, size, num_threads);
+        else if (op == 1)
+            pointer = aiss4::encode(text.data(), suffix, encoded, size);
+        else if (op == 2)
+            aiss4::decode(pointer, encoded, decoded, size);
+        else
+            aiss4::sais(text.data(), suffix, size, num_threads, op == 3 ? aiss4::engine_twostage : aiss4::engine_auto);
+        auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() * 1e-9);
+    }
+    bool valid = op == 1 || (op == 2 ? memcmp(decoded, text.data(), size) == 0 : aiss4::sais_check(text.data(), suffix, size));
+
+    delete [] suffix;
+    delete [] encoded;
+    delete [] decoded;
+
+    std::sort(times.begin(), times.end());
+    return valid ? times[times.size() / 2] : -1.0;
+}
+
+
+int main(int argc, char ** argv)
+{
+    int repeat = 5;
+    std::vector<int> threads(1, 1);
+    int64_t gen_size = 16 * 1024 * 1024;
+    const char * csv = NULL;
+    std::vector<std::string> inputs(generated, generated + 5);
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (strcmp(argv[arg], "--repeat") == 0 && arg + 1 < argc)
+            repeat = atoi(argv[++arg]);
+        else if (strcmp(argv[arg], "--size") == 0 && arg + 1 < argc)
+            gen_size = atoll(argv[++arg]);
+        else if (strcmp(argv[arg], "--threads") == 0 && arg + 1 < argc)
+        {
+            threads.clear();
+            for (const char * ptr = argv[++arg]; *ptr != '\0'; ptr += *ptr == ',' ? 1 : 0)
+            {
+                char * next = NULL;
+                threads.push_back(static_cast<int>(strtol(ptr, &next, 10)));
+                if (next == ptr){ threads.back() = 0; break; }
+                ptr = next;
+            }
+        }
+        else if (strcmp(argv[arg], "--csv") == 0 && arg + 1 < argc)
+            csv = argv[++arg];
+        else if (argv[arg][0] != '-')
+            inputs.push_back(argv[arg]);
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (repeat < 1 || threads.empty() || *std::min_element(threads.begin(), threads.end()) < 1 || gen_size < 1 || gen_size > INT32_MAX)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::ofstream writer;
+    if (csv != NULL)
+    {
+        writer.open(csv);
+        if (!writer.is_open())
+        {
+            std::cerr << "Cannot create " << csv << std::endl;
+            return 2;
+        }
+        writer << "input,operation,size,threads,repeat,median_s,mb_per_s,ns_per_byte,peak_rss_mb" << std::endl;
+    }
+
+    bool success = true;
+    for (const std::string & name : inputs)
+    {
+        for (int op = 0; op < 5; ++op)
+        {
+            double first = -1.0; // median time with threads[0]
+            for (size_t cnt = 0; cnt < (op == 1 || op == 2 ? 1 : threads.size()); ++cnt)
+            {
+                const int num_threads = threads[cnt];
+
+                // Child: median time and input size over a pipe; parent: peak RSS of the child with wait4
+                int fds[2];
+                if (pipe(fds) != 0)
+                    return 2;
+                const pid_t pid = fork();
+                if (pid == 0)
+                {
+                    close(fds[0]);
+                    double result[2] = { -1.0, 0.0 };
+                    result[0] = run_operation(name, static_cast<int32_t>(gen_size), op, repeat, num_threads, result[1]);
+                    const bool sent = write(fds[1], result, sizeof(result)) == sizeof(result);
+                    close(fds[1]);
+                    _exit(sent ? 0 : 1);
+                }
+                close(fds[1]);
+                double result[2] = { -1.0, 0.0 };
+                const bool received = pid > 0 && read(fds[0], result, sizeof(result)) == sizeof(result);
+                close(fds[0]);
+                int status = 0;
+                struct rusage resources;
+                memset(&resources, 0, sizeof(resources));
+                if (pid > 0)
+                    wait4(pid, &status, 0, &resources);
+                if (!received || result[0] < 0)
+                {
+                    std::cerr << "Failed " << operations[op] << " on " << name << std::endl;
+                    success = false;
+                    continue;
+                }
+
+                const double bytes = result[1];
+                const double mbs   = result[0] > 0 ? bytes / result[0] * 1e-6 : 0;
+                const double nspb  = bytes > 0 ? result[0] / bytes * 1e9 : 0;
+                const double rss   = resources.ru_maxrss / 1024.0;
+                first = cnt == 0 ? result[0] : first;
+                std::cout << name << " " << operations[op] << " (size = " << static_cast<int64_t>(bytes) << ", threads = " << num_threads
+                          << ", repeat = " << repeat << "): " << mbs << " MB/s, " << nspb << " ns/byte, peak RSS " << rss << " MB";
+                if (cnt > 0 && first > 0 && result[0] > 0)
+                    std::cout << ", speedup " << first / result[0] << " over threads = " << threads[0];
+                std::cout << std::endl;
+                if (csv != NULL)
+                    writer << name << "," << operations[op] << "," << static_cast<int64_t>(bytes) << "," << num_threads << "," << repeat << ","
+                           << result[0] << "," << mbs << "," << nspb << "," << rss << std::endl;
+            }
+        }
+    }
+
+    return success ? 0 : 3;
+}
+